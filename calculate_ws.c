@@ -5,6 +5,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+
+#include "tracegen.h"
 
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
@@ -14,6 +17,8 @@ typedef struct
     int pagesz, interval;
     const char * algorithm, * initialorder;
     int numelem;
+    char mode;            // 'T'umbling intervals or 'S'liding window
+    int step;             // # of references between samples (S)
 }
 sparameters;
 
@@ -22,20 +27,27 @@ sparameters;
 
 int parse_command (int, char*[], sparameters*);
 
-// Structure that maintains the set of referenced pages:
+// Structure that maintains the set of referenced pages. The
+// bits are kept in 64-bit words, and the words that have some
+// bit set are also kept in a list, so that counting and
+// clearing the set only costs as much as the pages touched
+// in the interval.
 
-#define NUM_BYTES(BITS) ((BITS+7)>>3)
-#define SET_BIT(P,NBIT) ((P)[(NBIT)>>3] |= 1<<((NBIT)&7))
-#define GET_BIT(P,NBIT) ((P)[(NBIT)>>3] & (1<<((NBIT)&7)))
+#define NUM_WORDS(BITS) (((BITS)+63)>>6)
+#define WORD_OF(NBIT) ((NBIT)>>6)
+#define MASK_OF(NBIT) ((uint64_t)1<<((NBIT)&63))
 
 typedef struct
 {
-    char * prefbits;      // Reference bits of the pages
-    int numbytes;         // Size in bytes
+    uint64_t * prefbits;  // Reference bits of the pages
+    unsigned numwords;    // Size in words
+    unsigned * dirtywords;// Words with some bit set...
+    unsigned numdirty;    // ...and how many of them
     unsigned numpages;    // # of pages (and ref. bits)
+    unsigned numdistinct; // # of pages referenced in interval
     unsigned numrefs;     // # of references in current interval
-    unsigned totalrefs;   // Total # of references
-    unsigned numillegal;  // # of illegal references
+    unsigned long long totalrefs;   // Total # of references
+    unsigned long long numillegal;  // # of illegal references
 }
 spgstate;
 
@@ -51,21 +63,66 @@ void annotate_reference (const sparameters *,
 void dump_num_refs (spgstate *);
 void print_header (void);
 
+// Structure that maintains the working set W(t,window) of
+// Denning over a sliding window of the last 'window'
+// references: the time of the last reference to each page,
+// the pages referenced in the window (a circular buffer)
+// and how many pages were last referenced inside it. Each
+// reference costs O(1).
+
+typedef struct
+{
+    unsigned long long * plast;  // Time of last ref. to each
+                                 // page (0 = none)
+    unsigned * pring;     // Page referenced at each time of window
+    unsigned window;      // Size of the window
+    unsigned numpages;    // # of pages
+    unsigned numinwindow; // # of pages in the working set
+    unsigned long long now;         // Current time (# of refs.)
+    unsigned long long numillegal;  // # of illegal references
+}
+swindow;
+
+// Functions that manipulate the sliding window
+
+int reserve_window (swindow *, int numpages, unsigned window);
+void free_window (swindow *);
+
+void slide_window (const sparameters *,
+                   swindow *,
+                   unsigned element);
+
+void dump_window (swindow *);
+
+// Function that receives the operations of the trace, and
+// the structure that it receives as its first parameter
+
+function_sink annotate_access;
+
+typedef struct
+{
+    const sparameters * pPar;
+    spgstate * pS;        // Tumbling intervals...
+    swindow * pW;         // ...or sliding window
+}
+sannotation;
+
 // Main function
 
 int main (int argc, char * argv[])
 {
     sparameters P;      // Parameters received in the command line
-    char command[100];  // Command for executing gen_trace
-    FILE * pipe;        // Communication channel with gen_traza
+    ssource T;          // Where the trace comes from
     int ok;             // Flag
-    char op;            // Elementary operation ('R'ead, 'W'ri..)
-    unsigned u;         // Number of the read/written element
     spgstate S;         // State of the pages (referenced/not)
+    swindow W;          // State of the pages (sliding window)
     unsigned numpags;   // Total number of pages
-    unsigned totelem;   // Total num. of elements (double in MER)
+    sannotation A;      // What the sink of the trace needs
 
     S.prefbits = NULL;
+    S.dirtywords = NULL;
+    W.plast = NULL;
+    W.pring = NULL;
 
     if (parse_command(argc,argv,&P)<0)  // Put parameters in P
         return -1;
@@ -74,33 +131,24 @@ int main (int argc, char * argv[])
             argv[0], P.pagesz, P.interval,
             P.algorithm, P.initialorder, P.numelem);
 
-    // Prepare command for invoking gen_trace
-    // (sprintf "prints" in a string)
-    sprintf (command, "./gen_trace %s %s %u",
-                      P.algorithm, P.initialorder, P.numelem);
+    if (P.mode=='S')
+        printf ("# Sliding window, sampled every %i "
+                "references\n", P.step);
 
-    printf ("# Executing command:  %s\n", command);
+    // Prepare the trace: it is generated in this process by
+    // the code of gen_trace (or read from the standard input)
+    ok = source_open (&T, P.algorithm, P.initialorder, P.numelem);
 
-    // Invoke gen_trace and open a pipe to read
-    // its standard output ("r" stands for read)
-    pipe = popen (command, "r");
-
-    if (!pipe)
-    {
-        perror ("ERROR while starting gen_trace");
-        return -1;
-    }
-
-    // Read total # of elements to be sorted
-    ok = fscanf (pipe," T %u", &totelem) == 1;
+    printf ("# Trace:  %s\n", T.name);
 
     if (ok)
     {
         // Calculate total number of pages
-        numpags = (totelem+P.pagesz-1) / P.pagesz; 
+        numpags = (T.totalsz+P.pagesz-1) / P.pagesz;
 
-        // Reserve space for the reference bits
-        if (reserve_bits(&S,numpags)<0)
+        // Reserve space for the reference bits (or times)
+        if ((P.mode=='S' ? reserve_window(&W,numpags,P.interval) :
+                           reserve_bits(&S,numpags)) < 0)
         {
             fprintf (stderr,
                      "ERROR: not enough "
@@ -112,42 +160,37 @@ int main (int argc, char * argv[])
     if (ok)
         print_header ();
 
-    while (ok)
+    // Annotate every memory access of the trace
+    if (ok)
     {
-        // Ignore spaces and read one character
-        if (fscanf(pipe," %c",&op)!=1)
-        {
-            ok = 0;
-            break;
-        }
-
-        if (op=='R' || op=='W')              // If R/W,
-        {                                    // take element
-            if (fscanf(pipe,"%u",&u)!=1)     // number and
-                ok = 0;                      // annotate
-            else
-                annotate_reference (&P, &S, u);
-        }
-        else if (op=='S')        // 'S'orted -> end
-            break;               // 'C'omparison -> go on
-        else if (op!='C')        // 'O'ut of order (or
-            ok = 0;              // something else) -> error
+        A.pPar = &P;
+        A.pS = &S;
+        A.pW = &W;
+        ok = source_run (&T, annotate_access, &A);
     }
 
     if (ok)
     {
-        dump_num_refs (&S);
+        if (P.mode=='S')
+        {
+            // Last sample, unless it has just been printed
+            if (W.now % P.step)
+                dump_window (&W);
+
+            S.numillegal = W.numillegal;
+        }
+        else
+            dump_num_refs (&S);
 
         if (S.numillegal)
-            printf ("WARNING: There were %u references to "
+            printf ("WARNING: There were %llu references to "
                              "nonexistent pages\n", S.numillegal);
     }
 
-    // Wait until gen_trace ends and close
-    if (pclose(pipe)==-1)
-        ok = 0;
+    source_close (&T);
 
     free_bits (&S);
+    free_window (&W);
 
     return ok ? 0 : -1;
 }
@@ -157,15 +200,14 @@ int main (int argc, char * argv[])
 int reserve_bits (spgstate * pS, int numpages)
 {
     pS->numpages = numpages;
-    pS->numbytes = NUM_BYTES (numpages);
+    pS->numwords = NUM_WORDS (numpages);
+    pS->numdirty = pS->numdistinct = 0;
     pS->numrefs = pS->totalrefs = pS->numillegal = 0;
-    pS->prefbits = (char*) malloc (pS->numbytes);
+    pS->prefbits = (uint64_t*) calloc (pS->numwords, sizeof(uint64_t));
+    pS->dirtywords = (unsigned*) malloc (pS->numwords*sizeof(unsigned));
 
-    if (pS->prefbits)
-    {
-        memset (pS->prefbits, 0, pS->numbytes);
+    if (pS->prefbits && pS->dirtywords)
         return 0;
-    }
 
     return -1;
 }
@@ -173,7 +215,22 @@ int reserve_bits (spgstate * pS, int numpages)
 void free_bits (spgstate * pS)
 {
     free (pS->prefbits);
+    free (pS->dirtywords);
     pS->prefbits = NULL;
+    pS->dirtywords = NULL;
+}
+
+void annotate_access (void * p, char op, unsigned pos)
+{
+    sannotation * pA = (sannotation*) p;
+
+    if (op=='C')          // 'C'omparisons do not access memory
+        return;
+
+    if (pA->pPar->mode=='S')
+        slide_window (pA->pPar, pA->pW, pos);
+    else
+        annotate_reference (pA->pPar, pA->pS, pos);
 }
 
 void annotate_reference (const sparameters * pPar,
@@ -181,12 +238,23 @@ void annotate_reference (const sparameters * pPar,
                          unsigned element)
 {
     unsigned page;
+    uint64_t * w;
 
     page = element / pPar->pagesz;
 
     if (page < pS->numpages)
     {
-        SET_BIT (pS->prefbits, page);
+        w = &pS->prefbits[WORD_OF(page)];
+
+        if (!(*w & MASK_OF(page)))
+        {
+            // First reference to the page in this interval
+            if (!*w)
+                pS->dirtywords[pS->numdirty++] = WORD_OF (page);
+
+            *w |= MASK_OF (page);
+            pS->numdistinct ++;
+        }
 
         if (++pS->numrefs >= pPar->interval)
             dump_num_refs (pS);
@@ -203,30 +271,108 @@ void print_header (void)
 
 void dump_num_refs (spgstate * pS)
 {
-    unsigned u, refs;
+    unsigned u;
 
     if (!pS->numrefs)
         return;
 
-    for (u=refs=0; u<pS->numpages; u++)
-        if (GET_BIT(pS->prefbits, u))
-            refs ++;
-
-    printf (" %15u %15u %15u %15f\n",
+    printf (" %15llu %15u %15u %15f\n",
             pS->totalrefs, pS->numrefs,
-            refs, refs/(float)pS->numrefs);
+            pS->numdistinct, pS->numdistinct/(float)pS->numrefs);
+
+    // Clear only the words that were touched
+    for (u=0; u<pS->numdirty; u++)
+        pS->prefbits[pS->dirtywords[u]] = 0;
 
-    memset (pS->prefbits, 0, pS->numbytes);
+    pS->numdirty = pS->numdistinct = 0;
     pS->totalrefs += pS->numrefs;
     pS->numrefs = 0;
 }
 
+// Functions that manipulate the sliding window
+
+int reserve_window (swindow * pW, int numpages, unsigned window)
+{
+    pW->numpages = numpages;
+    pW->window = window;
+    pW->numinwindow = pW->now = pW->numillegal = 0;
+    pW->plast = (unsigned long long*)
+                calloc (numpages, sizeof(unsigned long long));
+    pW->pring = (unsigned*) malloc (window*sizeof(unsigned));
+
+    if (pW->plast && pW->pring)
+        return 0;
+
+    return -1;
+}
+
+void free_window (swindow * pW)
+{
+    free (pW->plast);
+    free (pW->pring);
+    pW->plast = NULL;
+    pW->pring = NULL;
+}
+
+void slide_window (const sparameters * pPar,
+                   swindow * pW,
+                   unsigned element)
+{
+    unsigned page, old, slot;
+
+    page = element / pPar->pagesz;
+
+    if (page >= pW->numpages)
+    {
+        pW->numillegal ++;
+        return;
+    }
+
+    // The window becomes (now-window, now]
+    pW->now ++;
+    slot = pW->now % pW->window;
+
+    // The reference of time now-window leaves the window; its
+    // page leaves the working set if it was its last reference
+    if (pW->now > pW->window)
+    {
+        old = pW->pring[slot];
+
+        if (pW->plast[old] == pW->now-pW->window)
+            pW->numinwindow --;
+    }
+
+    if (!pW->plast[page] ||
+        pW->plast[page] + pW->window <= pW->now)
+        pW->numinwindow ++;
+
+    pW->plast[page] = pW->now;
+    pW->pring[slot] = page;
+
+    if (pW->now % pPar->step == 0)
+        dump_window (pW);
+}
+
+void dump_window (swindow * pW)
+{
+    unsigned long long start;
+    unsigned length;
+
+    if (!pW->now)
+        return;
+
+    // The window may not be full yet
+    length = pW->now < pW->window ? pW->now : pW->window;
+    start = pW->now - length;
+
+    printf (" %15llu %15u %15u %15f\n",
+            start, length,
+            pW->numinwindow, pW->numinwindow/(float)length);
+}
+
 // Function that parses the parameters received through the
 // command line:
 
-#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
-#define VALID_INITIAL_ORD "ASC/DES/RAN"
-
 int parse_command (int argc, char * argv[], sparameters * p)
 {
     int ok;
@@ -237,8 +383,10 @@ int parse_command (int argc, char * argv[], sparameters * p)
     p->algorithm = "MER";
     p->initialorder = "RAN";
     p->numelem = 1000;
+    p->mode = 'T';
+    p->step = 0;
 
-    if (argc>6)
+    if (argc>8)
         ok = 0;
     else
     {
@@ -263,9 +411,10 @@ int parse_command (int argc, char * argv[], sparameters * p)
         if (argc>3)
             p->algorithm = argv[3];
 
-        if (strlen(p->algorithm)!=3 ||
-            strchr(p->algorithm,'/') ||
-            !strstr(VALID_ALGORITHMS,p->algorithm))
+        if (strcmp(p->algorithm,"-") && !source_is_file(p->algorithm) &&
+            (strlen(p->algorithm)!=3 ||
+             strchr(p->algorithm,'/') ||
+             !strstr(VALID_ALGORITHMS,p->algorithm)))
         {
             fprintf (stderr,
                      "\n    ERROR: wrong algorithm\n");
@@ -277,7 +426,7 @@ int parse_command (int argc, char * argv[], sparameters * p)
 
         if (strlen(p->initialorder)!=3 ||
             strchr(p->initialorder,'/') ||
-            !strstr(VALID_INITIAL_ORD,p->initialorder))
+            !strstr(VALID_INIT_ORD,p->initialorder))
         {
             fprintf (stderr,
                      "\n    ERROR: wrong initial order\n");
@@ -292,6 +441,26 @@ int parse_command (int argc, char * argv[], sparameters * p)
                                   "elements\n");
             ok = 0;
         }
+
+        if (argc>6 && (strlen(argv[6])!=1 || !strchr("TS",argv[6][0])))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong mode\n");
+            ok = 0;
+        }
+        else if (argc>6)
+            p->mode = argv[6][0];
+
+        if (argc>7 && (sscanf(argv[7],"%d",&p->step)!=1 ||
+                       p->step<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong step\n");
+            ok = 0;
+        }
+
+        if (!p->step)               // By default, one sample
+            p->step = p->interval;  // per window
     }
 
     if (ok)
@@ -299,23 +468,30 @@ int parse_command (int argc, char * argv[], sparameters * p)
 
     fprintf (stderr,
              "\n    USAGE:\n\t%s pagesz interval algorithm "
-                        "initialorder numelem\n\n", argv[0]);
+                        "initialorder numelem mode step\n\n", argv[0]);
 
     fprintf (stderr,
              "\tpagesz: nº de elementos que caben "
                        "en una página\n"
              "\tinterval: # of operations per interval\n"
-             "\talgorithm: sorting algorithm (%s)\n"
+             "\talgorithm: sorting algorithm (%s),\n"
+             "\t     or - to read a trace from the standard input,\n"
+             "\t     or the name of a file with a trace (with a / or a .)\n"
              "\tinitialorder: initial order of the array (%s)\n"
              "\tnumelem: # of elements to be sorted\n"
+             "\tmode: T (consecutive intervals, the default) or S\n"
+             "\t     (sliding window of 'interval' references)\n"
+             "\tstep: in mode S, # of references between samples\n"
+             "\t     (by default, the interval)\n"
              "\n",
-             VALID_ALGORITHMS, VALID_INITIAL_ORD);
+             VALID_ALGORITHMS, VALID_INIT_ORD);
 
     fprintf (stderr,
-             "    EXAMPLE:\n"
+             "    EXAMPLES:\n"
              "\t%s 16 2000 MER RAN 1000\n"
+             "\t%s 16 2000 MER RAN 1000 S 100\n"
              "\n",
-             argv[0]);
+             argv[0], argv[0]);
 
     return -1;
 }
@@ -4,103 +4,95 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
-#define NUM_ALG 8
+#include "tracegen.h"
+
+#define NUM_ALG 12
 #define NUM_INI 3
-#define NUM_SZS 3
+#define MAX_SZS 16
+#define MAX_WORKERS 256
+
+// Initial states of the array: ASCending order,
+// DEScending order and RANdom order (or rather disorder)
+const char * initial[NUM_INI] = { "ASC", "DES", "RAN" };
+
+// Sorting algorithms: bubble, insertion, selection,
+// heapsort, combsort, mergesort, quicksort, quicksort with
+// random pivot, bottom-up mergesort, introsort, radix sort,
+// and in-place mergesort
+const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
+                                     "HEA", "COM", "MER",
+                                     "QUI", "QRP", "BMS",
+                                     "INT", "RAD", "IMS" };
 
-int main ()
+// Structure holding data of the parameters passed through
+// the command line, and the results of the experiments.
+// The workers share it with the parent process (it lives in a
+// MAP_SHARED mapping), and each one takes the next experiment
+// from 'next'.
+
+typedef struct
 {
-    // Initial states of the array: ASCending order,
-    // DEScending order and RANdom order (or rather disorder)
-    const char * initial[NUM_INI] = { "ASC", "DES", "RAN" };
-
-    // Array sizes with wich to experiment
-    unsigned sizes[NUM_SZS] = { 10, 100, 1000 };
-
-    // Sorting algorithms: bubble, insertion, selection,
-    // heapsort, combsort, mergesort, quicksort, and
-    // quicksort with random pivot
-    const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
-                                         "HEA", "COM", "MER",
-                                         "QUI", "QRP" };
-
-    char command[100]; // Command for executing gen_trace
-    FILE * pipe;       // Channel for communicating with gen_trace
-    int a, i, t, ok;   // Array indexes and flag
-    char op;           // Elementary operation ('R'ead, 'W'rite...)
-    unsigned u;        // Number of read/written element
-    unsigned sz;       // Size of the array to sort
+    unsigned sizes[MAX_SZS];       // Array sizes with wich to
+    int numsizes;                  // experiment
+    int numworkers;                // # of processes (-j)
+    int order[MAX_SZS];            // Indexes of sizes, largest first
 
-    unsigned reads, writes, comparisons;            // Counters
-    unsigned results[NUM_ALG][NUM_INI][NUM_SZS];    // Tables
+    int next;                      // Next experiment to be done
 
-    // Carry out experiments and fill results tables
+    unsigned long long results[NUM_ALG][NUM_INI][MAX_SZS];
+}
+sexperiments;
 
-    for (t=0; t<NUM_SZS; t++)
-        for (a=0; a<NUM_ALG; a++)
-            for (i=0; i<NUM_INI; i++)
-            {
-                sz = sizes[t];
-                reads = writes = comparisons = 0;
-
-                // Make command to invoke gen_trace
-                // (sprintf "prints" in a string)
-                sprintf (command, "./gen_trace %s %s %u",
-                                  algorithms[a], initial[i], sz);
-
-                printf ("Executing command: %s\n", command);
-
-                // Invoke gen_trace and open pipe for reading
-                // its standard output ("r" stands for read)
-                pipe = popen (command, "r");
-
-                if (!pipe)
-                {
-                    perror ("ERROR starting gen_trace");
-                    return -1;
-                }
-
-                // Read (and ignore) size
-                ok = fscanf (pipe," T %u", &u) == 1;
-
-                while (ok)
-                {
-                    // Ignore spaces and read one character
-                    if (fscanf(pipe," %c",&op)!=1)
-                    {
-                        ok = 0;
-                        break;
-                    }
-
-                    if (op=='R' || op=='W')  // If it's a read
-                    {                        // or a write,
-                        if (op=='R')         // count it and read
-                            reads ++;        // the number of the
-                        else                 // referenced
-                            writes ++;       // element (u)
-
-                        if (fscanf(pipe,"%u",&u)!=1)
-                            ok = 0;
-                    }
-                    else if (op=='C')        // 'C'omparison
-                        comparisons ++;
-                    else if (op=='S')        // 'S'orted (end)
-                        break;
-                    else                     // 'O'ut of order (or
-                        ok = 0;              // sth. else) -> error
-                }
-
-                // Wait until gen_trace ends and close
-                if (pclose(pipe)==-1)
-                    ok = 0;
-
-                // Store number of operations in the table
-                // (0 if an error occurred)
-                results[a][i][t] = ok ? reads +
-                                        writes +
-                                        comparisons : 0;
-            }
+int parse_command (int, char*[], sexperiments*);
+
+// Functions that carry out the experiments
+
+void run_experiment (sexperiments *, int e);
+void run_worker (sexperiments *);
+int run_workers (sexperiments *);
+
+int main (int argc, char * argv[])
+{
+    sexperiments * X;  // Parameters and results tables
+    int a, i, t, u;    // Array indexes
+
+    // Shared with the workers (and zero-filled)
+    X = (sexperiments*) mmap (NULL, sizeof(sexperiments),
+                              PROT_READ|PROT_WRITE,
+                              MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+
+    if (X==MAP_FAILED)
+    {
+        perror ("ERROR in mmap");
+        return -1;
+    }
+
+    if (parse_command(argc,argv,X)<0)
+        return -1;
+
+    // The largest experiments go first (insertion, stable)
+    for (t=0; t<X->numsizes; t++)
+    {
+        for (u=t; u>0 && X->sizes[X->order[u-1]]<X->sizes[t]; u--)
+            X->order[u] = X->order[u-1];
+
+        X->order[u] = t;
+    }
+
+    // Carry out experiments and fill results tables. Every
+    // experiment writes only its own cell, so the tables do not
+    // depend on the number of workers or on the order in which
+    // they end
+
+    if (X->numworkers==1)
+        run_worker (X);
+    else if (run_workers(X)<0)
+        return -1;
 
     // Print tables
 
@@ -114,15 +106,15 @@ int main ()
 
         printf ("\n\n");
 
-        for (t=0; t<NUM_SZS; t++)
+        for (t=0; t<X->numsizes; t++)
         {
-            printf ("%6u", sizes[t]);
+            printf ("%6u", X->sizes[t]);
 
             for (a=0; a<NUM_ALG; a++)
-                if (results[a][i][t]<1000000)
-                    printf (" %7u", results[a][i][t]);
+                if (X->results[a][i][t]<1000000)
+                    printf (" %7llu", X->results[a][i][t]);
                 else
-                    printf (" %7.1e", (float)results[a][i][t]);
+                    printf (" %7.1e", (float)X->results[a][i][t]);
 
             printf ("\n");
         }
@@ -130,6 +122,182 @@ int main ()
 
     printf ("\n");
 
+    munmap (X, sizeof(sexperiments));
+
+    return 0;
+}
+
+// Experiment e is the (e/(NUM_ALG*NUM_INI))-th largest size,
+// algorithm (e/NUM_INI)%NUM_ALG and initial state e%NUM_INI
+
+void run_experiment (sexperiments * pX, int e)
+{
+    int a, i, t, ok;   // Array indexes and flag
+    unsigned sz;       // Size of the array to sort
+    scontrol C;        // State of the instrumented array
+
+    t = pX->order[e / (NUM_ALG*NUM_INI)];
+    a = e / NUM_INI % NUM_ALG;
+    i = e % NUM_INI;
+
+    sz = pX->sizes[t];
+
+    printf ("Generating trace: %s %s %u\n",
+            algorithms[a], initial[i], sz);
+    fflush (stdout);
+
+    // Sort the array in this same process, without a sink:
+    // only the counters of scontrol are needed
+    ok = generate_trace (find_sort(algorithms[a]),
+                         find_prepare(initial[i]),
+                         sz, NULL, NULL, &C) == 1;
+
+    // Store number of operations in the table
+    // (0 if an error occurred)
+    pX->results[a][i][t] = ok ? C.nreads +
+                                C.nwrites +
+                                C.ncomparisons : 0;
+}
+
+// Takes experiments until there are no more left (the largest
+// sizes come first, so that no long one is left running alone
+// at the end while the other workers have nothing to do)
+
+void run_worker (sexperiments * pX)
+{
+    int e, numexp;
+
+    numexp = pX->numsizes * NUM_ALG * NUM_INI;
+
+    while ((e=__sync_fetch_and_add(&pX->next,1)) < numexp)
+        run_experiment (pX, e);
+}
+
+// Processes are used instead of threads because the traces of
+// QRP depend on the state of rand(), which is per process
+
+int run_workers (sexperiments * pX)
+{
+    pid_t pid[MAX_WORKERS];
+    int w, n, status, ok;
+
+    fflush (stdout);   // Not to be printed again by the children
+
+    for (w=0; w<pX->numworkers; w++)
+    {
+        pid[w] = fork ();
+
+        if (pid[w]==0)
+        {
+            run_worker (pX);
+            _exit (0);
+        }
+
+        if (pid[w]<0)
+        {
+            perror ("ERROR in fork");
+            break;
+        }
+    }
+
+    for (n=0, ok=w==pX->numworkers; n<w; n++)
+        if (waitpid(pid[n],&status,0)<0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status))
+            ok = 0;
+
+    if (!ok)
+    {
+        fprintf (stderr, "ERROR: a worker failed\n");
+        return -1;
+    }
+
     return 0;
 }
 
+// Function that parses the parameters received through the
+// command line:
+
+static int parse_sizes (const char * str, sexperiments * p)
+{
+    const char * s;
+    int n;
+
+    for (s=str, p->numsizes=0; *s; s+=n+(s[n]==','))
+    {
+        for (n=0; s[n] && s[n]!=','; n++)
+            ;
+
+        if (p->numsizes==MAX_SZS ||
+            sscanf(s,"%u",&p->sizes[p->numsizes])!=1 ||
+            p->sizes[p->numsizes]<2)
+            return -1;
+
+        p->numsizes ++;
+    }
+
+    return p->numsizes ? 0 : -1;
+}
+
+int parse_command (int argc, char * argv[], sexperiments * p)
+{
+    int ok, n;
+    long ncpus;
+
+    // Default parameters: as many workers as processors
+    ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+    p->numworkers = ncpus<1 ? 1 : ncpus>MAX_WORKERS ?
+                                      MAX_WORKERS : ncpus;
+    parse_sizes ("10,100,1000", p);
+
+    for (n=1, ok=1; ok && n<argc; n+=2)
+    {
+        if (n+1==argc)
+            ok = 0;
+        else if (!strcmp(argv[n],"-j"))
+        {
+            if (sscanf(argv[n+1],"%d",&p->numworkers)!=1 ||
+                p->numworkers<1 || p->numworkers>MAX_WORKERS)
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong number of workers\n");
+                ok = 0;
+            }
+        }
+        else if (!strcmp(argv[n],"-s"))
+        {
+            if (parse_sizes(argv[n+1],p)<0)
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong list of sizes\n");
+                ok = 0;
+            }
+        }
+        else
+            ok = 0;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    USAGE:\n\t%s [-j workers] [-s sizes]\n\n",
+             argv[0]);
+
+    fprintf (stderr,
+             "\tworkers: # of processes that run the experiments "
+                        "(1 to %d,\n"
+             "\t         by default, the # of processors)\n"
+             "\tsizes: comma-separated list of array sizes "
+                      "(10,100,1000)\n"
+             "\n",
+             MAX_WORKERS);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s\n"
+             "\t%s -j 4 -s 10,100,1000,10000\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
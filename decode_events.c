@@ -0,0 +1,191 @@
+/*
+    decode_events.c
+*/
+
+// Prints an event log written by the simulators in mode E
+// with the layout of their detailed mode (D)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_paging.h"
+
+#define NUM_EVENTS 4096   // Events read at once
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    const char * evfile;   // - for the standard input
+    char times;            // 1 = show the # of the reference
+}
+sparameters;
+
+int parse_command (int, char*[], sparameters*);
+
+// Function that prints one event
+
+void print_event (const sevheader * H, const sevent * e, char times);
+
+int main (int argc, char * argv[])
+{
+    sparameters P;
+    FILE * pf;
+    sevheader H;
+    sevent events[NUM_EVENTS];
+    size_t n, u;
+    int ok;
+
+    if (parse_command(argc,argv,&P)<0)
+        return -1;
+
+    pf = strcmp(P.evfile,"-") ? fopen (P.evfile,"rb") : stdin;
+
+    if (!pf)
+    {
+        perror ("ERROR opening the event log");
+        return -1;
+    }
+
+    ok = fread (&H,sizeof(H),1,pf)==1 &&
+         !memcmp (H.magic,EV_MAGIC,sizeof(EV_MAGIC));
+
+    if (!ok)
+        fprintf (stderr, "ERROR: %s is not an event log\n", P.evfile);
+    else
+    {
+        H.policy[sizeof(H.policy)-1] = '\0';
+
+        printf ("# Events:  %s %i %i (%i pages)\n",
+                H.policy, H.pagsz, H.numframes, H.numpags);
+
+        while ((n = fread (events,sizeof(sevent),NUM_EVENTS,pf)) > 0)
+            for (u=0; u<n; u++)
+                print_event (&H, &events[u], P.times);
+
+        if (ferror(pf))
+        {
+            perror ("ERROR reading the event log");
+            ok = 0;
+        }
+    }
+
+    if (pf!=stdin)
+        fclose (pf);
+
+    return ok ? 0 : -1;
+}
+
+// Function that prints one event (the same text as sim_mmu,
+// handle_page_fault and the policies in mode D)
+
+void print_event (const sevheader * H, const sevent * e, char times)
+{
+    if (times)
+        printf ("%llu:", (unsigned long long) e->t);
+
+    switch (e->type)
+    {
+        case EV_REFERENCE:
+            printf ("\t %c %u==P %d(M %d)+ %u\n", e->op, e->addr,
+                    e->page, e->frame,
+                    e->addr - (unsigned)e->page*H->pagsz);
+            break;
+
+        case EV_FAULT:
+            printf ("@ PAGE_FAULT in P %d!\n", e->page);
+            break;
+
+        case EV_STORE:
+            printf ("@ Storing P%d in F%d\n", e->page, e->frame);
+            break;
+
+        case EV_CHOOSE:
+            printf ("@ Choosing (at %s) P%d of F%d to be replaced",
+                    H->policy, e->page, e->frame);
+
+            // OPT also tells when the victim is used again
+            if (e->op=='N')
+                printf (" (not used again)");
+            else if (e->op=='U')
+                printf (" (next use: reference %llu)",
+                        (unsigned long long) e->hi << 32 | e->addr);
+
+            printf ("\n");
+            break;
+
+        case EV_WRITEBACK:
+            printf ("@ Writing modified P%d back (to disc) to "
+                    "%s it\n", e->page,
+                    e->op==EV_RELEASE ? "release" : "replace");
+            break;
+
+        case EV_RELEASE:
+            printf ("@ Releasing P%d of F%d\n", e->page, e->frame);
+            break;
+
+        case EV_REPLACE:
+            printf ("@ Replacing victim P%u with P%d in F%d\n",
+                    e->addr, e->page, e->frame);
+            break;
+
+        default:
+            printf ("@ Unknown event '%c'\n", e->type);
+    }
+}
+
+// Function that parses the parameters received through the
+// command line
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok;
+
+    // Default parameters
+    p->evfile = "events.sev";
+    p->times = 0;
+
+    ok = argc<=3;
+
+    if (!ok)
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+
+    if (argc>1)
+        p->evfile = argv[1];
+
+    if (argc>2)
+    {
+        if (strcmp(argv[2],"T"))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong option");
+            ok = 0;
+        }
+
+        p->times = 1;
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n\n    USAGE:\n\t%s evfile [T]\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tevfile: event log of a simulator in mode E\n"
+             "\t     (events.sev), or - for the standard input\n"
+             "\tT: show the # of the reference of every event\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s mer.sev\n"
+             "\t%s mer.sev T | grep PAGE_FAULT\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
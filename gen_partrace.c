@@ -0,0 +1,287 @@
+/*
+    gen_partrace.c
+*/
+
+// gen_trace for the parallel algorithms of partrace.h: writes
+// the interleaved trace of all the threads (in the same formats
+// as gen_trace, so that the simulators can read it), and
+// optionally the trace of every thread to a file of its own
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort.h"
+#include "trace.h"
+#include "tracegen.h"
+#include "partrace.h"
+
+// Functions that write the operations to the logs (sinks of
+// partrace.h):
+
+function_batch_sink log_text, log_binary;
+function_thread_sink log_thread;
+
+// The sinks receive, as their first parameter, a pointer to a
+// structure of this type:
+
+typedef struct
+{
+    FILE * pf;                    // Interleaved trace
+    unsigned numops;              // Operations logged (text)
+    unsigned last;                // Last position logged (binary)
+    FILE * pft[MAX_THREADS];      // Trace of every thread
+    unsigned lastt[MAX_THREADS];  // (or NULL)
+}
+slog;
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    function_prepare_data * pprepare;
+    function_par_sort * psort;
+    int size;
+    int numthreads;
+    char format;           // 'T'ext, 'B'inary or 'S'ummary
+    const char * prefix;   // Of the traces of the threads (or NULL)
+}
+sparameters;
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char *[], sparameters *);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;     // Parameters
+    spartrace R;       // Counters
+    slog L;            // Operations logs
+    unsigned totalsz;  // Total # of elements (2*size in PMS)
+    unsigned long long reads, writes, comparisons;
+    char name[1024];
+    int sorted, k;
+
+    if (parse_command(argc,argv,&P)<0)
+        return -1;
+
+    totalsz = par_total_size (P.psort, P.size);
+
+    L.pf = stdout;
+    L.numops = 0;
+    L.last = 0;
+
+    for (k=0; k<MAX_THREADS; k++)
+    {
+        L.pft[k] = NULL;
+        L.lastt[k] = 0;
+    }
+
+    // Open the traces of the threads
+    for (k=0; P.prefix && k<P.numthreads && k<P.size; k++)
+    {
+        snprintf (name, sizeof(name), "%s.%d.trb", P.prefix, k);
+
+        if (!(L.pft[k] = fopen (name,"wb")))
+        {
+            perror ("ERROR creating the trace of a thread");
+            return -1;
+        }
+
+        trace_put_header (L.pft[k], totalsz);
+    }
+
+    // Show total size
+    if (P.format=='B')
+        trace_put_header (L.pf, totalsz);
+    else if (P.format=='T')
+        printf (" T%u\n", totalsz);
+
+    sorted = generate_partrace (P.psort, P.pprepare, P.size,
+                                P.numthreads,
+                                P.format=='B' ? log_binary :
+                                P.format=='T' ? log_text : NULL,
+                                P.prefix ? log_thread : NULL,
+                                &L, &R);
+
+    if (sorted<0)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory, "
+                         "or the threads could not be created.\n");
+        return -2;
+    }
+
+    for (k=0; k<MAX_THREADS; k++)
+        if (L.pft[k])
+        {
+            trace_put_end (L.pft[k], sorted);
+            fclose (L.pft[k]);
+        }
+
+    if (P.format=='B')
+        trace_put_end (stdout, sorted);
+    else if (P.format=='T')
+        printf (" %s\n", sorted?"Sorted ;-)":"Out of order :-(");
+    else
+    {
+        printf ("%8s %12s %12s %12s\n", "Thread", "Reads", "Writes",
+                "Comparisons");
+
+        reads = writes = comparisons = 0;
+
+        for (k=0; k<R.numthreads; k++)
+        {
+            printf ("%8d %12llu %12llu %12llu\n", k, R.nreads[k],
+                    R.nwrites[k], R.ncomparisons[k]);
+
+            reads += R.nreads[k];
+            writes += R.nwrites[k];
+            comparisons += R.ncomparisons[k];
+        }
+
+        printf ("%8s %12llu %12llu %12llu\n\n", "Total", reads,
+                writes, comparisons);
+
+        printf ("Phases:      %u\n"
+                "Steps:       %llu (%.2f operations per step)\n"
+                "%s\n",
+                R.numphases, R.steps,
+                R.steps ? (double)(reads+writes+comparisons)/R.steps : 0,
+                sorted?"Sorted ;-)":"Out of order :-(");
+    }
+
+    return 0;
+}
+
+// Functions that write the operations to the logs:
+
+void log_text (void * p, const unsigned * refs, unsigned n)
+{
+    slog * pl = (slog*) p;
+    unsigned u;
+
+    for (u=0; u<n; u++)
+    {
+        if (TRACE_REF_OP(refs[u])=='C')
+            fprintf (pl->pf, " C");
+        else
+            fprintf (pl->pf, " %c%u", TRACE_REF_OP(refs[u]),
+                     TRACE_REF_POS(refs[u]));
+
+        if ((++pl->numops & 7) == 0)
+            fputc ('\n', pl->pf);
+    }
+}
+
+void log_binary (void * p, const unsigned * refs, unsigned n)
+{
+    slog * pl = (slog*) p;
+    unsigned u;
+
+    for (u=0; u<n; u++)
+        trace_put_op (pl->pf, &pl->last, TRACE_REF_OP(refs[u]),
+                      TRACE_REF_POS(refs[u]));
+}
+
+void log_thread (void * p, unsigned thread, const unsigned * refs,
+                 unsigned n)
+{
+    slog * pl = (slog*) p;
+    unsigned u;
+
+    for (u=0; u<n; u++)
+        trace_put_op (pl->pft[thread], &pl->lastt[thread],
+                      TRACE_REF_OP(refs[u]), TRACE_REF_POS(refs[u]));
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int argc, char * argv[],
+                   sparameters * pPar)
+{
+    unsigned u;
+
+    // Default parameters:
+    pPar->pprepare = random_order;
+    pPar->psort = parallel_merge_sort;
+    pPar->size = 4;
+    pPar->numthreads = 2;
+    pPar->format = 'T';
+    pPar->prefix = NULL;
+
+    if (argc>1)
+    {
+        pPar->psort = find_par_sort (argv[1]);
+
+        if (!pPar->psort)
+        {
+            fprintf (stderr, "ERROR: Unknown parallel sorting "
+                             "algorithm \"%s\" (must be %s)\n",
+                             argv[1], VALID_PAR_ALGORITHMS);
+            return -1;
+        }
+    }
+
+    if (argc>2)
+    {
+        pPar->pprepare = find_prepare (argv[2]);
+
+        if (!pPar->pprepare)
+        {
+            fprintf (stderr, "ERROR: Unknown initial "
+                             "state \"%s\"\n", argv[2]);
+            return -1;
+        }
+    }
+
+    if (argc>3)
+    {
+        u = sscanf (argv[3], "%d", &pPar->size);
+
+        if (u!=1 || pPar->size<2 || pPar->size>MAX_SIZE)
+        {
+            fprintf (stderr, "ERROR: Wrong size (must be "
+                             "a number ranging from 2 "
+                             "to %u\n", MAX_SIZE);
+            return -1;
+        }
+    }
+
+    if (argc>4)
+    {
+        u = sscanf (argv[4], "%d", &pPar->numthreads);
+
+        if (u!=1 || pPar->numthreads<1 ||
+            pPar->numthreads>MAX_THREADS)
+        {
+            fprintf (stderr, "ERROR: Wrong number of threads "
+                             "(must be a number ranging from 1 "
+                             "to %d)\n", MAX_THREADS);
+            return -1;
+        }
+    }
+
+    if (argc>5)
+    {
+        if (strcmp(argv[5],"TXT") && strcmp(argv[5],"BIN") &&
+            strcmp(argv[5],"SUM"))
+        {
+            fprintf (stderr, "ERROR: Unknown trace "
+                             "format \"%s\" (must be "
+                             "TXT, BIN or SUM)\n", argv[5]);
+            return -1;
+        }
+
+        pPar->format = argv[5][0];
+    }
+
+    if (argc>6)
+        pPar->prefix = argv[6];
+
+    return 0;
+}
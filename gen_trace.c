@@ -7,40 +7,25 @@
 #include <string.h>
 
 #include "sort.h"
+#include "trace.h"
+#include "tracegen.h"
 
-// Functions that prepare the data according to
-// different criteria:
+// Functions that write the operations of the sorting
+// algorithms to the log (sinks of tracegen.h):
 
-typedef void function_prepare_data (thing A[], unsigned size);
+function_sink log_text;
+function_batch_sink log_binary;
 
-function_prepare_data ascending_order,
-                      descending_order,
-                      random_order;
-
-// Functions that the sorting algorithms should use in order
-// to access the data of the array:
-
-thing read (void *, unsigned pos);
-void write (void *, unsigned pos, thing value);
-
-// Functions that the sorting algorithms should use in order
-// to compare values of the array:
-
-int lesser_than (void *, thing a, thing b);
-int lesser_than_back_to_front (void *, thing a, thing b);
-
-// The 'read' and 'write' functions receive, as their first
-// parameter, a pointer to a structure of this type:
+// The sinks receive, as their first parameter, a pointer to a
+// structure of this type:
 
 typedef struct
 {
-    thing * pdata;            // Array with data to be sorted
-    unsigned nreads;          // Read operations counter
-    unsigned nwrites;         // Write operations counter
-    unsigned ncomparisons;    // Comparisons counter
     FILE * pf;                // Operations log
+    unsigned numops;          // Operations logged
+    unsigned last;            // Last position logged (binary)
 }
-scontrol;
+slog;
 
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
@@ -50,6 +35,7 @@ typedef struct
     function_prepare_data * pprepare;
     function_sort * psort;
     int size;
+    char format;       // 'T'ext, 'B'inary or 'S'ummary
 }
 sparameters;
 
@@ -62,182 +48,83 @@ int parse_command (int, char *[], sparameters *);
 
 int main (int argc, char * argv[])
 {
-    thing * A;         // Dynamic array with data to sort
     scontrol C;        // Struct controlling access to array
     sparameters P;     // Parameters
-    unsigned totalsz;  // Total # of elements (2*size in MER)
-    unsigned u;
+    slog L;            // Operations log
+    unsigned totalsz;  // Total # of elements (2*size in MER, BMS, RAD)
+    int sorted;
 
     if (parse_command(argc,argv,&P)<0)
         return -1;
 
-    totalsz = P.psort==merge_sort ? P.size*2 : P.size;
-    A = (thing*) malloc (totalsz*sizeof(thing));
+    totalsz = total_size (P.psort, P.size);
 
-    if (!A)
+    L.pf = stdout;
+    L.numops = 0;
+    L.last = 0;
+
+    // Show total size
+    if (P.format=='B')
+        trace_put_header (L.pf, totalsz);
+    else if (P.format=='T')
+        printf (" T%u\n", totalsz);
+
+    // Sort data with specified algorithm (without logging the
+    // operations in a summary, which only shows the counters;
+    // the binary log takes them in batches)
+    sorted = P.format=='B' ?
+               generate_trace_batch (P.psort, P.pprepare, P.size,
+                                     log_binary, &L, &C) :
+               generate_trace (P.psort, P.pprepare, P.size,
+                               P.format=='T' ? log_text : NULL,
+                               &L, &C);
+
+    if (sorted<0)
     {
         fprintf (stderr, "ERROR: not enough "
                          "dynamic memory.\n");
         return -2;
     }
 
-    C.pdata = A;
-
-    // Generate data in specified initial state
-    P.pprepare (A, P.size);
+    if (P.format=='B')
+        trace_put_end (stdout, sorted);
+    else if (P.format=='T')
+        printf (" %s\n", sorted?"Sorted ;-)":"Out of order :-(");
+    else
+        printf ("Reads:       %llu\n"
+                "Writes:      %llu\n"
+                "Comparisons: %llu\n"
+                "%s\n",
+                C.nreads, C.nwrites, C.ncomparisons,
+                sorted?"Sorted ;-)":"Out of order :-(");
 
-    // Reset counters
-    C.nreads = C.nwrites = C.ncomparisons = 0;
-    C.pf = stdout;
-
-    // Show total size
-    printf (" T%u\n", totalsz);
-
-    // Sort data with specified algorithm
-    P.psort (&C,
-             P.size,
-             lesser_than,
-             read,
-             write);
-
-    C.pf = NULL;
-
-    for (u=0; u<P.size-1; u++)
-        if (lesser_than(&C,A[u+1],A[u]))
-            break;
-
-    printf (" %s\n", u<P.size-1?"Out of order :-(":"Sorted ;-)");
-    free (A);
     return 0;
 }
 
-// Functions that the sorting algorithms should use in order
-// to access the data of the array:
+// Functions that write the operations of the sorting
+// algorithms to the log:
 
-thing read (void * p, unsigned pos)
+void log_text (void * p, char op, unsigned pos)
 {
-    scontrol * pc = (scontrol*) p;
-
-    pc->nreads ++;
+    slog * pl = (slog*) p;
 
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " R%u", pos);
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
+    if (op=='C')
+        fprintf (pl->pf, " C");
+    else
+        fprintf (pl->pf, " %c%u", op, pos);
 
-    return pc->pdata[pos];
+    if ((++pl->numops & 7) == 0)
+        fputc ('\n', pl->pf);
 }
 
-void write (void * p, unsigned pos, thing value)
-{
-    scontrol * pc = (scontrol*) p;
-
-    pc->nwrites ++;
-
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " W%u", pos);
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
-
-    pc->pdata[pos] = value;
-}
-
-// Functions that the sorting algorithms should use in order
-// to compare values of the array:
-
-int lesser_than (void * p, thing a, thing b)
-{
-    scontrol * pc = (scontrol*) p;
-
-    pc->ncomparisons ++;
-
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " C");
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
-
-    return a < b;
-}
-
-int lesser_than_back_to_front (void * p, thing a, thing b)
-{
-    scontrol * pc = (scontrol*) p;
-
-    pc->ncomparisons ++;
-
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " C");
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
-
-    return a > b;
-}
-
-// Functions that prepare the data according to
-// different criteria:
-
-void ascending_order (thing A[], unsigned size)
-{
-    unsigned u;
-
-    for (u=0; u<size; u++)
-        A[u] = u;
-}
-
-void descending_order (thing A[], unsigned size)
+void log_binary (void * p, const unsigned * refs, unsigned n)
 {
+    slog * pl = (slog*) p;
     unsigned u;
 
-    for (u=0; u<size; u++)
-        A[u] = size-u-1;
-}
-
-void random_order (thing A[], unsigned size)
-{
-    unsigned u, n;
-    thing tmp;
-
-    srand (0);
-
-    for (u=0; u<5; u++)
-        rand ();
-
-    ascending_order (A, size);
-
-    for (u=0; u<size-1; u++)
-    {
-        n = 1 + u + (unsigned)(rand() * (size-u-1.0) / RAND_MAX);
-
-        if (n>size-1)
-            n = size-1;
-
-        if (n!=u)
-        {
-            tmp = A[n];
-            A[n] = A[u];
-            A[u] = tmp;
-        }
-    }
+    for (u=0; u<n; u++)
+        trace_put_op (pl->pf, &pl->last, TRACE_REF_OP(refs[u]),
+                      TRACE_REF_POS(refs[u]));
 }
 
 // Function that parses the parameters received through the
@@ -248,45 +135,17 @@ int parse_command (int argc, char * argv[],
 {
     unsigned u;
 
-    struct
-    {
-        function_prepare_data * pfun;
-        const char * name;
-    }
-    G[] = { { ascending_order, "ASC" },
-            { descending_order, "DES" },
-            { random_order, "RAN" },
-            { NULL, NULL } };
-
-    struct
-    {
-        function_sort * pfun;
-        const char * name;
-    }
-    S[] = { { bubble_sort, "BUB" },
-            { insertion_sort, "INS" },
-            { selection_sort, "SEL" },
-            { heap_sort, "HEA" },
-            { comb_sort, "COM" },
-            { merge_sort, "MER" },
-            { quick_sort, "QUI" },
-            { quick_sort_pa, "QRP" },
-            { NULL, NULL } }	;
-
     // Default parameters:
     pPar->pprepare = random_order;
     pPar->psort = merge_sort;
     pPar->size = 4;
+    pPar->format = 'T';
 
     if (argc>1)
     {
-        for (u=0; S[u].pfun; u++)
-            if (!strcmp(argv[1],S[u].name))
-                break;
+        pPar->psort = find_sort (argv[1]);
 
-        if (S[u].pfun)
-            pPar->psort = S[u].pfun;
-        else
+        if (!pPar->psort)
         {
             fprintf (stderr, "ERROR: Unknown sorting "
                              "algorithm \"%s\"\n", argv[1]);
@@ -296,13 +155,9 @@ int parse_command (int argc, char * argv[],
 
     if (argc>2)
     {
-        for (u=0; G[u].pfun; u++)
-            if (!strcmp(argv[2],G[u].name))
-                break;
+        pPar->pprepare = find_prepare (argv[2]);
 
-        if (G[u].pfun)
-            pPar->pprepare = G[u].pfun;
-        else
+        if (!pPar->pprepare)
         {
             fprintf (stderr, "ERROR: Unknown initial "
                              "state \"%s\"\n", argv[2]);
@@ -314,16 +169,28 @@ int parse_command (int argc, char * argv[],
     {
         u = sscanf (argv[3], "%d", &pPar->size);
 
-        if (u!=1 || pPar->size<2 || pPar->size>10000)
+        if (u!=1 || pPar->size<2 || pPar->size>MAX_SIZE)
         {
             fprintf (stderr, "ERROR: Wrong size (must be "
                              "a number ranging from 2 "
-                             "to 10000\n");
+                             "to %u\n", MAX_SIZE);
             return -1;
         }
     }
 
-    return 0;
-}
+    if (argc>4)
+    {
+        if (strcmp(argv[4],"TXT") && strcmp(argv[4],"BIN") &&
+            strcmp(argv[4],"SUM"))
+        {
+            fprintf (stderr, "ERROR: Unknown trace "
+                             "format \"%s\" (must be "
+                             "TXT, BIN or SUM)\n", argv[4]);
+            return -1;
+        }
 
+        pPar->format = argv[4][0];
+    }
 
+    return 0;
+}
@@ -0,0 +1,569 @@
+/*
+    partrace.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "trace.h"
+#include "partrace.h"
+
+#define PAR_BATCH 4096        // Operations handed at once to pmerged
+#define PAR_BUFFER 65536      // Initial capacity of every buffer
+#define MAX_TASKS (2*MAX_THREADS)
+
+// What a thread has to do in a phase: 'S'ort size elements from
+// position from as MER does (with the space from totalsz/2 on),
+// 'M'erge the lists of size and right elements from position
+// from into dest, 'C'opy size elements from position from to
+// dest, 'P'artition size elements from position from (leaving
+// the position of the pivot in hole), or sort them as 'Q'UI
+
+typedef struct
+{
+    char kind;
+    unsigned thread;
+    unsigned from, size, right, dest;
+    unsigned hole;
+}
+stask;
+
+// One thread of the pool. Only the thread writes in its own
+// buffer while a phase lasts; after it, the main thread merges
+// all of them and empties them.
+
+typedef struct
+{
+    spool * pP;
+    unsigned id;
+    thing * A;                  // The array (shared)
+    unsigned * refs;            // Operations of this phase
+    size_t numrefs, capacity;
+    int error;                  // The buffer could not grow
+    unsigned long long nreads, nwrites, ncomparisons;
+    pthread_t th;
+}
+sworker;
+
+struct spool
+{
+    thing * A;
+    unsigned size;              // Elements to be sorted
+    unsigned numthreads;
+
+    stask tasks[MAX_TASKS];     // Tasks of the current phase
+    unsigned numtasks;
+
+    pthread_mutex_t lock;       // Protects the three below
+    pthread_cond_t go, done;
+    unsigned phase;             // # of the current phase
+    unsigned numdone;           // Threads that finished it
+    int quit;
+
+    sworker W[MAX_THREADS];
+
+    function_batch_sink * pmerged;
+    function_thread_sink * pperthread;
+    void * pctx;
+    spartrace * pr;
+    unsigned batch[PAR_BATCH];  // Interleaved trace
+    unsigned numbatch;
+};
+
+// Functions that the threads use in order to access the data
+// of the array and compare them (as lesser_than)
+
+static inline void worker_put (sworker * pw, unsigned ref)
+{
+    unsigned * p;
+
+    if (pw->error)
+        return;
+
+    if (pw->numrefs==pw->capacity)
+    {
+        p = (unsigned*) realloc (pw->refs,
+                                 2*pw->capacity*sizeof(unsigned));
+
+        if (!p)
+        {
+            pw->error = 1;
+            return;
+        }
+
+        pw->refs = p;
+        pw->capacity *= 2;
+    }
+
+    pw->refs[pw->numrefs++] = ref;
+}
+
+static inline thing worker_read (sworker * pw, unsigned pos)
+{
+    pw->nreads ++;
+    worker_put (pw, TRACE_REF('R',pos));
+
+    return pw->A[pos];
+}
+
+static inline void worker_write (sworker * pw, unsigned pos,
+                                 thing value)
+{
+    pw->nwrites ++;
+    worker_put (pw, TRACE_REF('W',pos));
+
+    pw->A[pos] = value;
+}
+
+static inline int worker_lesser (sworker * pw, thing a, thing b)
+{
+    pw->ncomparisons ++;
+    worker_put (pw, TRACE_REF('C',0));
+
+    return a < b;
+}
+
+// The sorting algorithms, specialized for the threads (see
+// sort_impl.h; only some of them are used here)
+
+#define SORT_NAME(x) thread_##x
+#define SORT_CTX sworker *
+#define SORT_READ(c,pos) worker_read (c, pos)
+#define SORT_WRITE(c,pos,v) worker_write (c, pos, v)
+#define SORT_LESS(c,a,b) worker_lesser (c, a, b)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "sort_impl.h"
+#pragma GCC diagnostic pop
+
+// Function that carries out one task
+
+static void run_task (sworker * pw, stask * t)
+{
+    unsigned u, total = pw->pP->size;
+
+    switch (t->kind)
+    {
+        case 'S':
+            for (u=0; u<t->size; u++)
+                worker_write (pw, total+t->from+u,
+                              worker_read (pw, t->from+u));
+
+            thread_merge_sort_r (pw, t->size, t->from, total+t->from);
+            break;
+
+        case 'M':
+            thread_merge (pw, t->from, t->size, t->right, t->dest);
+            break;
+
+        case 'C':
+            for (u=0; u<t->size; u++)
+                worker_write (pw, t->dest+u,
+                              worker_read (pw, t->from+u));
+            break;
+
+        case 'P':
+            t->hole = thread_partition (pw, t->from, t->size,
+                                        worker_read (pw, t->from));
+            break;
+
+        case 'Q':
+            thread_quick_sort_r (pw, t->from, t->size, 0);
+            break;
+    }
+}
+
+// Function that every thread of the pool runs: waits for a
+// phase, does its tasks in it, and tells the main thread
+
+static void * run_worker (void * p)
+{
+    sworker * pw = (sworker*) p;
+    spool * pP = pw->pP;
+    unsigned t, seen = 0;
+    int quit;
+
+    for (;;)
+    {
+        pthread_mutex_lock (&pP->lock);
+
+        while (pP->phase==seen && !pP->quit)
+            pthread_cond_wait (&pP->go, &pP->lock);
+
+        seen = pP->phase;
+        quit = pP->quit;
+
+        pthread_mutex_unlock (&pP->lock);
+
+        if (quit)
+            break;
+
+        for (t=0; t<pP->numtasks; t++)
+            if (pP->tasks[t].thread==pw->id)
+                run_task (pw, &pP->tasks[t]);
+
+        pthread_mutex_lock (&pP->lock);
+
+        if (++pP->numdone==pP->numthreads)
+            pthread_cond_signal (&pP->done);
+
+        pthread_mutex_unlock (&pP->lock);
+    }
+
+    return NULL;
+}
+
+// Function that puts one operation in the interleaved trace
+
+static void merged_put (spool * pP, unsigned ref)
+{
+    pP->batch[pP->numbatch++] = ref;
+
+    if (pP->numbatch==PAR_BATCH)
+    {
+        pP->pmerged (pP->pctx, pP->batch, PAR_BATCH);
+        pP->numbatch = 0;
+    }
+}
+
+// Function that runs the tasks of the pool as one phase, and
+// then merges and empties the buffers of the threads. Returns
+// -1 if a buffer could not grow.
+
+static int run_phase (spool * pP)
+{
+    unsigned k;
+    size_t i, steps;
+
+    pthread_mutex_lock (&pP->lock);
+
+    pP->numdone = 0;
+    pP->phase ++;
+    pthread_cond_broadcast (&pP->go);
+
+    while (pP->numdone<pP->numthreads)
+        pthread_cond_wait (&pP->done, &pP->lock);
+
+    pthread_mutex_unlock (&pP->lock);
+
+    for (k=0, steps=0; k<pP->numthreads; k++)
+    {
+        if (pP->W[k].error)
+            return -1;
+
+        if (pP->W[k].numrefs>steps)
+            steps = pP->W[k].numrefs;
+
+        if (pP->pperthread && pP->W[k].numrefs)
+            pP->pperthread (pP->pctx, k, pP->W[k].refs,
+                            pP->W[k].numrefs);
+    }
+
+    // The i-th operation of every thread, by order of id
+
+    if (pP->pmerged)
+        for (i=0; i<steps; i++)
+            for (k=0; k<pP->numthreads; k++)
+                if (i<pP->W[k].numrefs)
+                    merged_put (pP, pP->W[k].refs[i]);
+
+    for (k=0; k<pP->numthreads; k++)
+        pP->W[k].numrefs = 0;
+
+    pP->pr->numphases ++;
+    pP->pr->steps += steps;
+
+    return 0;
+}
+
+static void add_task (spool * pP, char kind, unsigned thread,
+                      unsigned from, unsigned size,
+                      unsigned right, unsigned dest)
+{
+    stask * t = &pP->tasks[pP->numtasks++];
+
+    t->kind = kind;
+    t->thread = thread;
+    t->from = from;
+    t->size = size;
+    t->right = right;
+    t->dest = dest;
+    t->hole = 0;
+}
+
+// Parallel mergesort: the array in as many chunks as threads,
+// each one sorted by one thread, and then the chunks merged by
+// pairs (by half as many threads each time) from one half of
+// the space into the other, as in the bottom-up mergesort
+
+int parallel_merge_sort (spool * pP)
+{
+    unsigned start[MAX_THREADS+1];   // Runs: [start[k],start[k+1])
+    unsigned n, k, u, src, dst;
+    unsigned size = pP->size, T = pP->numthreads;
+
+    for (k=0; k<=T; k++)
+        start[k] = (unsigned) ((unsigned long long) size*k/T);
+
+    // First: every thread sorts its chunk (into the first half)
+
+    pP->numtasks = 0;
+
+    for (k=0; k<T; k++)
+        add_task (pP, 'S', k, start[k], start[k+1]-start[k], 0, 0);
+
+    if (run_phase(pP)<0)
+        return -1;
+
+    // Second: merge pairs of runs
+
+    for (n=T, src=0, dst=size; n>1; n=(n+1)/2, u=src, src=dst, dst=u)
+    {
+        pP->numtasks = 0;
+
+        for (k=0; k<n; k+=2)
+            add_task (pP, 'M', k/2, src+start[k],
+                      start[k+1]-start[k],
+                      k+1<n ? start[k+2]-start[k+1] : 0,
+                      dst+start[k]);
+
+        if (run_phase(pP)<0)
+            return -1;
+
+        for (k=0; 2*k<n; k++)
+            start[k] = start[2*k];
+
+        start[k] = size;
+    }
+
+    // Third: if the last merge left them in the second half,
+    // every thread brings back a part
+
+    if (src)
+    {
+        pP->numtasks = 0;
+
+        for (k=0; k<T; k++)
+        {
+            u = (unsigned) ((unsigned long long) size*k/T);
+            add_task (pP, 'C', k, size+u,
+                      (unsigned) ((unsigned long long) size*(k+1)/T) - u,
+                      0, u);
+        }
+
+        if (run_phase(pP)<0)
+            return -1;
+    }
+
+    return 0;
+}
+
+// Parallel quicksort: every part (at first, the whole array)
+// is partitioned by one thread, until there are at least as
+// many parts of more than one element as threads, and then
+// thread k%T sorts part k
+
+int parallel_quick_sort (spool * pP)
+{
+    unsigned from[MAX_TASKS], size[MAX_TASKS];
+    unsigned newfrom[MAX_TASKS], newsize[MAX_TASKS];
+    unsigned n, m, k, hole, T = pP->numthreads;
+
+    from[0] = 0;
+    size[0] = pP->size;
+    n = pP->size>1;
+
+    while (n>0 && n<T)
+    {
+        pP->numtasks = 0;
+
+        for (k=0; k<n; k++)
+            add_task (pP, 'P', k, from[k], size[k], 0, 0);
+
+        if (run_phase(pP)<0)
+            return -1;
+
+        for (k=m=0; k<n; k++)
+        {
+            hole = pP->tasks[k].hole;
+
+            if (hole-from[k]>1)
+            {
+                newfrom[m] = from[k];
+                newsize[m++] = hole - from[k];
+            }
+
+            if (from[k]+size[k]-hole-1>1)
+            {
+                newfrom[m] = hole + 1;
+                newsize[m++] = from[k] + size[k] - hole - 1;
+            }
+        }
+
+        memcpy (from, newfrom, m*sizeof(unsigned));
+        memcpy (size, newsize, m*sizeof(unsigned));
+        n = m;
+    }
+
+    if (n==0)
+        return 0;
+
+    pP->numtasks = 0;
+
+    for (k=0; k<n; k++)
+        add_task (pP, 'Q', k%T, from[k], size[k], 0, 0);
+
+    return run_phase (pP);
+}
+
+// Function that looks for an algorithm by its name
+
+static const struct
+{
+    function_par_sort * pfun;
+    const char * name;
+    unsigned space;
+}
+P[] = { { parallel_merge_sort, "PMS", 2 },
+        { parallel_quick_sort, "PQS", 1 },
+        { NULL, NULL, 0 } };
+
+function_par_sort * find_par_sort (const char * name)
+{
+    unsigned u;
+
+    for (u=0; P[u].pfun; u++)
+        if (!strcmp(name,P[u].name))
+            break;
+
+    return P[u].pfun;
+}
+
+unsigned par_total_size (function_par_sort * psort, unsigned size)
+{
+    unsigned u;
+
+    for (u=0; P[u].pfun; u++)
+        if (P[u].pfun==psort)
+            return P[u].space*size;
+
+    return size;
+}
+
+// Function that prepares and sorts the array with a pool of
+// threads
+
+int generate_partrace (function_par_sort * psort,
+                       function_prepare_data * pprepare,
+                       unsigned size, unsigned numthreads,
+                       function_batch_sink * pmerged,
+                       function_thread_sink * pperthread,
+                       void * pctx, spartrace * pr)
+{
+    spool * pP;
+    unsigned k, created, u;
+    int ok;
+
+    if (numthreads>MAX_THREADS)
+        numthreads = MAX_THREADS;
+
+    if (numthreads>size)
+        numthreads = size;
+
+    if (numthreads<1)
+        numthreads = 1;
+
+    pP = (spool*) calloc (1, sizeof(spool));
+
+    if (!pP)
+        return -1;
+
+    pP->A = (thing*) malloc (par_total_size(psort,size)*sizeof(thing));
+    pP->size = size;
+    pP->numthreads = numthreads;
+    pP->pmerged = pmerged;
+    pP->pperthread = pperthread;
+    pP->pctx = pctx;
+    pP->pr = pr;
+
+    memset (pr, 0, sizeof(spartrace));
+    pr->numthreads = numthreads;
+
+    pthread_mutex_init (&pP->lock, NULL);
+    pthread_cond_init (&pP->go, NULL);
+    pthread_cond_init (&pP->done, NULL);
+
+    ok = pP->A!=NULL;
+
+    if (ok)
+        pprepare (pP->A, size);
+
+    // Start the pool
+
+    for (created=0; ok && created<numthreads; )
+    {
+        sworker * pw = &pP->W[created];
+
+        pw->pP = pP;
+        pw->id = created;
+        pw->A = pP->A;
+        pw->capacity = PAR_BUFFER;
+        pw->refs = (unsigned*) malloc (PAR_BUFFER*sizeof(unsigned));
+
+        ok = pw->refs &&
+             !pthread_create (&pw->th, NULL, run_worker, pw);
+
+        if (ok)
+            created ++;
+        else
+            free (pw->refs);
+    }
+
+    if (ok)
+        ok = psort (pP)==0;
+
+    // Stop it
+
+    pthread_mutex_lock (&pP->lock);
+    pP->quit = 1;
+    pthread_cond_broadcast (&pP->go);
+    pthread_mutex_unlock (&pP->lock);
+
+    for (k=0; k<created; k++)
+    {
+        pthread_join (pP->W[k].th, NULL);
+        free (pP->W[k].refs);
+
+        pr->nreads[k] = pP->W[k].nreads;
+        pr->nwrites[k] = pP->W[k].nwrites;
+        pr->ncomparisons[k] = pP->W[k].ncomparisons;
+    }
+
+    if (ok && pmerged && pP->numbatch)
+        pmerged (pctx, pP->batch, pP->numbatch);
+
+    // Check whether it is sorted
+
+    if (ok)
+    {
+        for (u=1; u<size; u++)
+            if (pP->A[u]<pP->A[u-1])
+                break;
+
+        ok = u>=size;
+    }
+    else
+        ok = -1;
+
+    pthread_cond_destroy (&pP->done);
+    pthread_cond_destroy (&pP->go);
+    pthread_mutex_destroy (&pP->lock);
+
+    free (pP->A);
+    free (pP);
+
+    return ok;
+}
@@ -0,0 +1,96 @@
+/*
+    partrace.h
+*/
+
+#ifndef PARTRACE_H_
+#define PARTRACE_H_
+
+// Traces of parallel sorting algorithms: several threads sort
+// one array (a pool of them, which go through the algorithm in
+// phases separated by barriers), and each of them keeps the
+// operations it makes in its own buffer, which no other thread
+// touches while the phase lasts. After every phase, the
+// buffers are merged into one trace as if all the threads had
+// run at the same speed: the i-th operation of every thread in
+// the phase (its logical time) goes before the (i+1)-th ones,
+// and operations with the same logical time go in the order of
+// the thread ids. The interleaved trace is thus the same in
+// every run, however the threads are actually scheduled. (The
+// buffers hold a whole phase, 4 bytes per operation, and most
+// of the operations are in the first one.)
+//
+// PMS (parallel mergesort): every thread sorts one chunk of
+// the array as MER does, and then pairs of chunks are merged
+// by half as many threads each time. PQS (parallel
+// quicksort): partitions (with the first element as pivot,
+// as QUI) are split by as many threads as there are parts,
+// until there are at least as many parts as threads, and then
+// every thread sorts its parts as QUI does. With one thread,
+// PMS is MER and PQS is QUI, operation by operation.
+
+#include "sort.h"
+#include "tracegen.h"
+
+#define VALID_PAR_ALGORITHMS "PMS/PQS"
+#define MAX_THREADS 16
+
+// Pool of threads going through an algorithm (see partrace.c)
+
+typedef struct spool spool;
+
+// Type of the functions that plan the phases of a parallel
+// algorithm on a pool
+
+typedef int function_par_sort (spool *);
+
+function_par_sort parallel_merge_sort, parallel_quick_sort;
+
+// Function that looks for an algorithm by its name in the
+// command line (NULL if it is unknown), and total # of
+// elements that it uses (PMS needs twice the size)
+
+function_par_sort * find_par_sort (const char * name);
+unsigned par_total_size (function_par_sort * psort, unsigned size);
+
+// Type of the functions that receive the operations of one
+// thread (as in TRACE_REF, comparisons included), phase by
+// phase
+
+typedef void function_thread_sink (void * ctx, unsigned thread,
+                                   const unsigned * refs,
+                                   unsigned n);
+
+// Counters of a parallel sort: the operations of every
+// thread, and the length of the interleaved trace in logical
+// time (the sum of the longest buffer of every phase), which
+// is to the total of operations what the running time of the
+// parallel sort is to that of the sequential one
+
+typedef struct
+{
+    unsigned numthreads;       // Threads that took part
+    unsigned numphases;
+    unsigned long long steps;  // Logical time at the end
+    unsigned long long nreads[MAX_THREADS];
+    unsigned long long nwrites[MAX_THREADS];
+    unsigned long long ncomparisons[MAX_THREADS];
+}
+spartrace;
+
+// Function that prepares an array of the given size and sorts
+// it with numthreads threads (at most MAX_THREADS, and not more
+// than size), sending the interleaved trace to pmerged and the
+// operations of each thread to pperthread (either can be NULL).
+// Leaves the counters in *pr and returns 1 if the array ended
+// up sorted, 0 if not, and -1 if there is not enough memory or
+// the threads cannot be created. size must be at most
+// MAX_SIZE.
+
+int generate_partrace (function_par_sort * psort,
+                       function_prepare_data * pprepare,
+                       unsigned size, unsigned numthreads,
+                       function_batch_sink * pmerged,
+                       function_thread_sink * pperthread,
+                       void * pctx, spartrace * pr);
+
+#endif  // PARTRACE_H_
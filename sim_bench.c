@@ -0,0 +1,512 @@
+/*
+    sim_bench.c
+*/
+
+// Measures how fast the stages of the simulators run, so that
+// versions can be compared: generation of the traces (the
+// sorting algorithms on the instrumented array of tracegen.c),
+// parsing of a captured binary trace (trace.c), and simulation
+// of the references (sim_mmu one by one, as in mode N, and
+// folded into runs, as in mode C and sim_pag_sweep).
+//
+// Every algorithm of VALID_ALGORITHMS is run on a random array,
+// and its trace is simulated with every policy (but OPT, which
+// needs the whole trace beforehand), page size and number of
+// frames of the fixed matrix below. Each measurement is taken
+// in a child process (the best time of reps attempts),
+// so that the peak RSS reported by wait4 is the one of that
+// stage (for the simulations, it includes the trace, which is
+// kept in memory). The results are written as CSV, one line
+// per measurement, to be compared between versions.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "sim_paging.h"
+#include "tracegen.h"
+
+#define NUM_ALG 12
+#define NUM_POL 9
+#define NUM_PAGSZ 2
+#define NUM_FRAMES 2
+#define BATCH 4096
+
+// Matrix of experiments
+
+const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
+                                     "HEA", "COM", "MER",
+                                     "QUI", "QRP", "BMS",
+                                     "INT", "RAD", "IMS" };
+
+const spolicy * policies[NUM_POL] = { &policy_random, &policy_fifo,
+                                      &policy_fifo2ch, &policy_lru,
+                                      &policy_lru_list, &policy_clock,
+                                      &policy_gclock, &policy_ws,
+                                      &policy_pff };
+
+const char * policynames[NUM_POL] = { "random", "fifo", "fifo2ch",
+                                      "lru", "lru_list", "clock",
+                                      "gclock", "ws", "pff" };
+
+const int pagesizes[NUM_PAGSZ] = { 16, 256 };
+const int framecounts[NUM_FRAMES] = { 8, 64 };
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    int numelem;          // # of elements to be sorted
+    int reps;             // Best time of this many attempts
+}
+sparameters;
+
+int parse_command (int, char*[], sparameters*);
+
+// What a stage does, and what it leaves for the parent (in a
+// MAP_SHARED mapping)
+
+typedef struct
+{
+    const char * stage;
+    const char * algorithm;
+    const spolicy * policy;   // Only for the simulations
+    const char * policyname;
+    int pagsz, numframes;
+    char mode;                // 'N' or 'C' (simulations)
+    int fd;                   // Captured trace (parsing, or -1)
+    const sreferences * pR;   // Loaded trace (simulations)
+    unsigned numelem;
+}
+sstage;
+
+typedef struct
+{
+    unsigned long long refs;  // Operations handled by the stage
+    unsigned long long faults;  // Only for the simulations
+    double seconds;           // Best time
+    int ok;
+}
+sresult;
+
+// Functions that run the stages
+
+int run_algorithm (sstage *, int reps, sresult *);
+int run_stage (const sstage *, int reps, sresult *, long * pmaxrss);
+int stage_generation (const sstage *, sresult *);
+int stage_parsing (const sstage *, sresult *);
+int stage_simulation (const sstage *, sresult *);
+void print_result (const sstage *, const sresult *, long maxrss);
+
+// Sinks of the traces: counting the operations, and capturing
+// them in binary format
+
+typedef struct
+{
+    FILE * pf;
+    unsigned last;
+    unsigned long long numops;
+}
+scapture;
+
+function_sink count_op, capture_op;
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    sstage G;           // Stage being measured
+    sresult * pres;     // Its result (shared with the children)
+    int a, ok;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    pres = (sresult*) mmap (NULL, sizeof(sresult),
+                            PROT_READ|PROT_WRITE,
+                            MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+
+    if (pres==MAP_FAILED)
+    {
+        perror ("ERROR in mmap");
+        return -1;
+    }
+
+    printf ("# Parameters:  %s %i %i\n", argv[0], P.numelem, P.reps);
+    printf ("stage,alg,policy,pagsz,frames,refs,faults,"
+            "seconds,ns_per_ref,refs_per_s,maxrss_kb\n");
+    fflush (stdout);
+
+    memset (&G, 0, sizeof(G));
+    G.numelem = P.numelem;
+    G.fd = -1;
+
+    for (a=0, ok=1; ok && a<NUM_ALG; a++)
+    {
+        G.algorithm = algorithms[a];
+        ok = run_algorithm (&G, P.reps, pres) == 0;
+    }
+
+    munmap (pres, sizeof(sresult));
+
+    if (!ok)
+    {
+        fprintf (stderr, "ERROR: the benchmark of %s failed\n",
+                 G.algorithm);
+        return -1;
+    }
+
+    return 0;
+}
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// Measures every stage with the trace of an algorithm. It runs
+// in its own process, so that what it allocates (the trace
+// loaded for the simulations) does not count in the RSS of the
+// stages of the next algorithms
+
+int run_algorithm (sstage * pG, int reps, sresult * pres)
+{
+    scapture K;         // Captured trace
+    scontrol C;         // State of the instrumented array
+    ssource T;          // Trace loaded for the simulations
+    sreferences R;
+    long maxrss;        // Peak RSS of a stage (KiB)
+    int p, g, f, m, ok, status;
+    pid_t pid;
+
+    fflush (stdout);   // Not to be printed again by the child
+
+    if ((pid=fork()) < 0)
+    {
+        perror ("ERROR in fork");
+        return -1;
+    }
+
+    if (pid)
+        return waitpid(pid,&status,0)==pid && WIFEXITED(status) &&
+               WEXITSTATUS(status)==0 ? 0 : -1;
+
+    // Generation alone
+    pG->stage = "generation";
+    ok = run_stage(pG,reps,pres,&maxrss)==0;
+
+    if (ok)
+        print_result (pG, pres, maxrss);
+
+    // Capture the trace (not measured), and parse it
+    if (ok && !(K.pf=tmpfile()))
+    {
+        perror ("ERROR in tmpfile");
+        ok = 0;
+    }
+
+    if (ok)
+    {
+        K.last = 0;
+        trace_put_header (K.pf, total_size(find_sort(pG->algorithm),
+                                           pG->numelem));
+        ok = generate_trace (find_sort(pG->algorithm), random_order,
+                             pG->numelem, capture_op, &K, &C) == 1;
+        trace_put_end (K.pf, ok);
+        ok = ok && fflush(K.pf)==0;
+
+        if (ok)
+        {
+            pG->stage = "parsing";
+            pG->fd = fileno (K.pf);
+            ok = run_stage(pG,reps,pres,&maxrss)==0;
+        }
+
+        if (ok)
+            print_result (pG, pres, maxrss);
+
+        fclose (K.pf);
+        pG->fd = -1;
+    }
+
+    // Load the trace (not measured), and simulate it
+    R.refs = NULL;
+    pG->pR = &R;
+
+    if (ok)
+    {
+        ok = source_open (&T, pG->algorithm, "RAN", pG->numelem) &&
+             load_references (&R, &T) == 1;
+        source_close (&T);
+    }
+
+    for (m=0; ok && m<2; m++)
+        for (p=0; ok && p<NUM_POL; p++)
+            for (g=0; ok && g<NUM_PAGSZ; g++)
+                for (f=0; ok && f<NUM_FRAMES; f++)
+                {
+                    pG->stage = m ? "simulation_runs" : "simulation";
+                    pG->mode = m ? 'C' : 'N';
+                    pG->policy = policies[p];
+                    pG->policyname = policynames[p];
+                    pG->pagsz = pagesizes[g];
+                    pG->numframes = framecounts[f];
+                    ok = run_stage(pG,reps,pres,&maxrss)==0;
+
+                    if (ok)
+                        print_result (pG, pres, maxrss);
+                }
+
+    free_references (&R);
+
+    _exit (ok ? 0 : 1);
+}
+
+// Runs a stage reps times in a child process, and leaves in
+// *pres the best time and in *pmaxrss the peak RSS of the child
+
+int run_stage (const sstage * pG, int reps, sresult * pres,
+               long * pmaxrss)
+{
+    struct rusage ru;
+    sresult r;
+    pid_t pid;
+    int n, status;
+    double t;
+
+    fflush (stdout);   // Not to be printed again by the child
+    memset (pres, 0, sizeof(sresult));
+
+    pid = fork ();
+
+    if (pid<0)
+    {
+        perror ("ERROR in fork");
+        return -1;
+    }
+
+    if (pid==0)
+    {
+        for (n=0, r.ok=1; r.ok && n<reps; n++)
+        {
+            t = now ();
+
+            if (pG->policy)
+                r.ok = stage_simulation (pG, &r) == 0;
+            else if (pG->fd>=0)
+                r.ok = stage_parsing (pG, &r) == 0;
+            else
+                r.ok = stage_generation (pG, &r) == 0;
+
+            r.seconds = now () - t;
+
+            if (n==0 || r.seconds<pres->seconds)
+                *pres = r;
+        }
+
+        pres->ok = r.ok;
+        _exit (0);
+    }
+
+    if (wait4(pid,&status,0,&ru)<0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status) || !pres->ok)
+        return -1;
+
+    *pmaxrss = ru.ru_maxrss;
+
+    return 0;
+}
+
+int stage_generation (const sstage * pG, sresult * pres)
+{
+    scontrol C;        // State of the instrumented array
+    scapture K;        // Only counts the operations
+
+    K.numops = 0;
+
+    if (generate_trace(find_sort(pG->algorithm), random_order,
+                       pG->numelem, count_op, &K, &C) != 1)
+        return -1;
+
+    pres->refs = K.numops;
+
+    return 0;
+}
+
+int stage_parsing (const sstage * pG, sresult * pres)
+{
+    static strace T;           // Too large for the stack
+    unsigned refs[BATCH];
+    unsigned totalsz;
+    char end;
+    int n;
+
+    if (lseek(pG->fd,0,SEEK_SET)<0 || !trace_open(&T,pG->fd,&totalsz))
+        return -1;
+
+    pres->refs = 0;
+
+    do
+    {
+        if ((n=trace_next_batch(&T,refs,BATCH,&end)) < 0)
+            return -1;
+
+        pres->refs += n;
+    }
+    while (!end);
+
+    return end=='S' ? 0 : -1;
+}
+
+int stage_simulation (const sstage * pG, sresult * pres)
+{
+    ssystem S;
+    srun R;
+    size_t u;
+    unsigned r;
+
+    memset (&S, 0, sizeof(S));
+
+    S.policy = pG->policy;
+    S.pagsz = pG->pagsz;
+    S.numpags = (pG->pR->totalsz+pG->pagsz-1) / pG->pagsz;
+    S.numframes = pG->numframes;
+    S.frt = (sframe*) malloc (S.numframes*sizeof(sframe));
+
+    if (alloc_page_table(&S)<0 || !S.frt)
+        return -1;
+
+    S.policy->init_tables (&S);
+
+    if (pG->mode=='C')
+    {
+        run_start (&R);
+
+        for (u=0; u<pG->pR->numrefs; u++)
+        {
+            r = pG->pR->refs[u];
+            run_reference (&S, &R, TRACE_REF_POS(r), TRACE_REF_OP(r));
+        }
+
+        run_flush (&S, &R);
+    }
+    else
+        for (u=0; u<pG->pR->numrefs; u++)
+        {
+            r = pG->pR->refs[u];
+            sim_mmu (&S, TRACE_REF_POS(r), TRACE_REF_OP(r));
+        }
+
+    pres->refs = pG->pR->numrefs;
+    pres->faults = S.numpagefaults;
+
+    free_page_table (&S);
+    free (S.frt);
+
+    return 0;
+}
+
+void print_result (const sstage * pG, const sresult * pres, long maxrss)
+{
+    double ns, rate;
+
+    ns = pres->refs ? pres->seconds*1e9/pres->refs : 0;
+    rate = pres->seconds>0 ? pres->refs/pres->seconds : 0;
+
+    printf ("%s,%s,%s,", pG->stage, pG->algorithm,
+            pG->policy ? pG->policyname : "-");
+
+    if (pG->policy)
+        printf ("%d,%d,%llu,%llu,", pG->pagsz, pG->numframes,
+                pres->refs, pres->faults);
+    else
+        printf ("-,-,%llu,-,", pres->refs);
+
+    printf ("%.6f,%.2f,%.0f,%ld\n",
+            pres->seconds, ns, rate, maxrss);
+    fflush (stdout);
+}
+
+void count_op (void * p, char op, unsigned pos)
+{
+    ((scapture*) p)->numops ++;
+}
+
+void capture_op (void * p, char op, unsigned pos)
+{
+    scapture * pK = (scapture*) p;
+
+    trace_put_op (pK->pf, &pK->last, op, pos);
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok;
+
+    // Default parameters
+    p->numelem = 2000;
+    p->reps = 3;
+
+    if (argc>3)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        ok = 1;
+
+        if (argc>1 && (sscanf(argv[1],"%d",&p->numelem)!=1 ||
+                       p->numelem<2 || p->numelem>MAX_SIZE))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of elements");
+            ok = 0;
+        }
+
+        if (argc>2 && (sscanf(argv[2],"%d",&p->reps)!=1 ||
+                       p->reps<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of repetitions");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n\n    USAGE:\n\t%s numelem reps\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tnumelem: # of elements to be sorted (2000)\n"
+             "\treps: # of times each stage is measured; the "
+                     "best time is\n"
+             "\t      reported (3)\n"
+             "\n");
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s\n"
+             "\t%s 5000 5\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
@@ -0,0 +1,244 @@
+/*
+    sim_pag_clock.c
+*/
+
+// CLOCK: the same replacement as FIFO 2nd chance, but the
+// occupied frames are not kept in a list. Frames are occupied
+// in the order of the list of free frames (0, 1, 2...), so the
+// FIFO order is that of the frames table itself, and an index
+// that goes round it (the hand) takes the place of the list.
+// The hand stays on the victim, as listoccupied does in
+// sim_pag_fifo2ch.c, so both give the same results.
+//
+// GCLOCK (generalized CLOCK) also keeps a counter per frame:
+// when the hand finds the reference bit of a page set, it
+// clears it and adds one to the counter (up to GCLOCK_MAX);
+// when it finds the bit clear, it takes one from the counter,
+// and only replaces the page if the counter is already 0. With
+// GCLOCK_MAX 0, it is CLOCK.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./sim_paging.h"
+
+#define GCLOCK_MAX 3
+
+// Function that initialises the tables
+
+static void init_tables(ssystem* S) {
+  int i;
+
+  // Reset pages
+  clear_page_table(S);
+
+  // Split of addresses for this page size
+  init_translation(S);
+
+  // Circular list of free frames
+  for (i = 0; i < S->numframes - 1; i++) {
+    S->frt[i].page = -1;
+    S->frt[i].next = i + 1;
+    S->frt[i].count = 0;
+  }
+
+  S->frt[i].page = -1;  // Now i == numframes-1
+  S->frt[i].next = 0;   // Close circular list
+  S->frt[i].count = 0;
+  S->listfree = i;      // Point to the last one
+
+  // First frame to be examined
+  S->hand = 0;
+}
+
+// Functions that simulate the hardware of the MMU
+
+static void reference_page(ssystem* S, int page, char op) {
+  if (op == 'R') {              // If it's a read,
+    S->numrefsread++;           // count it
+  } else if (op == 'W') {       // If it's a write,
+    PAGE_MODIFIED(S, page) = 1; // count it and mark the
+    S->numrefswrite++;          // page 'modified'
+  }
+  PAGE_REFERENCED(S, page) = 1;
+}
+
+static void reference_run(ssystem* S, int page,
+                          unsigned long long reads,
+                          unsigned long long writes) {
+  S->numrefsread += reads;
+  S->numrefswrite += writes;
+
+  if (writes)
+    PAGE_MODIFIED(S, page) = 1;
+
+  PAGE_REFERENCED(S, page) = 1;
+}
+
+// Functions that simulate the operating system
+
+static void advance_hand(ssystem* S) {
+  if (++S->hand == S->numframes)
+    S->hand = 0;
+}
+
+static int choose_page_to_be_replaced(ssystem* S) {
+  int page;
+
+  // Skip (and clear) the referenced pages
+  while (PAGE_REFERENCED(S, page = S->frt[S->hand].page)) {
+    PAGE_REFERENCED(S, page) = 0;
+    advance_hand(S);
+    STATS_SEARCH_COST(S, 1);
+  }
+
+  STATS_SEARCH_COST(S, 1);
+
+  if (S->detailed)
+    printf(
+        "@ Choosing (at CLOCK) P%d of F%d to be "
+        "replaced\n",
+        page, S->hand);
+
+  return page;
+}
+
+static int choose_page_to_be_replaced_gclock(ssystem* S) {
+  sframe* f;
+  int page;
+
+  for (;;) {
+    STATS_SEARCH_COST(S, 1);
+    f = &S->frt[S->hand];
+    page = f->page;
+
+    if (PAGE_REFERENCED(S, page)) {
+      PAGE_REFERENCED(S, page) = 0;
+
+      if (f->count < GCLOCK_MAX)
+        f->count++;
+    } else if (f->count > 0) {
+      f->count--;
+    } else {
+      break;
+    }
+
+    advance_hand(S);
+  }
+
+  if (S->detailed)
+    printf(
+        "@ Choosing (at GCLOCK) P%d of F%d to be "
+        "replaced\n",
+        page, S->hand);
+
+  return page;
+}
+
+static void replace_page(ssystem* S, int victim, int newpage) {
+  int frame = PAGE_FRAME(S, victim);
+
+  if (PAGE_MODIFIED(S, victim)) {
+    if (S->detailed)
+      printf(
+          "@ Writing modified P%d back (to disc) to "
+          "replace it\n",
+          victim);
+
+    S->numpgwriteback++;
+  }
+
+  if (S->detailed)
+    printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
+
+  PAGE_PRESENT(S, victim) = 0;
+
+  PAGE_PRESENT(S, newpage) = 1;
+  PAGE_FRAME(S, newpage) = frame;
+  PAGE_MODIFIED(S, newpage) = 0;
+
+  S->frt[frame].page = newpage;
+  S->frt[frame].count = 0;
+}
+
+static void occupy_free_frame(ssystem* S, int frame, int page) {
+  if (S->detailed)
+    printf("@ Storing P%d in F%d\n", page, frame);
+
+  PAGE_PRESENT(S, page) = 1;
+  PAGE_FRAME(S, page) = frame;
+  PAGE_MODIFIED(S, page) = 0;
+  PAGE_REFERENCED(S, page) = 1;
+
+  S->frt[frame].page = page;
+  S->frt[frame].count = 0;
+}
+
+// Functions that show results
+
+static void print_page_table(ssystem* S) {
+  int p;
+
+  printf("%10s %10s %10s %10s %10s\n", "PAGE", "Present", "Frame", "Modified", "Referenced");
+
+  for (p = 0; p < S->numpags; p++)
+    if (PAGE_PRESENT(S, p))
+      printf("%8d   %6d     %8d   %6d     %6d\n", p, PAGE_PRESENT(S, p),
+             PAGE_FRAME(S, p), PAGE_MODIFIED(S, p), PAGE_REFERENCED(S, p));
+    else
+      printf("%8d   %6d     %8s   %6s     %6s\n", p, PAGE_PRESENT(S, p), "-", "-", "-");
+}
+
+static void print_frames_table(ssystem* S) {
+  int p, f;
+
+  printf("%10s %10s %10s %10s %10s\n", "FRAME", "Page", "Modified", "Referenced", "Count");
+
+  for (f = 0; f < S->numframes; f++) {
+    p = S->frt[f].page;
+
+    if (p == -1)
+      printf("%8d   %8s     %6s       %6s     %6s\n", f, "-", "-", "-", "-");
+    else
+      printf("%8d   %8d     %6d       %6d     %6d\n", f, p, PAGE_MODIFIED(S, p),
+             PAGE_REFERENCED(S, p), S->frt[f].count);
+  }
+}
+
+static void print_replacement_report(ssystem* S) {
+  printf("CLOCK replacement (Hand at frame %d)\n", S->hand);
+}
+
+static void print_replacement_report_gclock(ssystem* S) {
+  printf("GCLOCK replacement (Hand at frame %d, counters up to %d)\n",
+         S->hand, GCLOCK_MAX);
+}
+
+// Replacement policies
+
+const spolicy policy_clock = {
+  "CLOCK",
+  init_tables,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report
+};
+
+const spolicy policy_gclock = {
+  "GCLOCK",
+  init_tables,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced_gclock,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report_gclock
+};
@@ -12,11 +12,14 @@
 
 // Function that initialises the tables
 
-void init_tables(ssystem* S) {
+static void init_tables(ssystem* S) {
   int i;
 
   // Reset pages
-  memset(S->pgt, 0, sizeof(spage) * S->numpags);
+  clear_page_table(S);
+
+  // Split of addresses for this page size
+  init_translation(S);
 
   // Empty LRU stack
   S->lru = -1;
@@ -40,93 +43,28 @@ S->listfree = i;       // El último marco libre apunta al final.
 
 // Functions that simulate the hardware of the MMU
 
-unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
-  unsigned physical_addr;
-  int page, frame, offset;
-//Calcular pagina y desplazamiento.
-  page   = virtual_addr / S->pagsz;  // División entera: obtienes el número de página.
-  offset = virtual_addr % S->pagsz; // Residuo: obtienes el desplazamiento dentro de la página.
-//Para controlar q no se accede a direcciones no permitidas
-
-  if ( page <0 || page >= S->numpags )
-  {
-	  S->numillegalrefs++;  // References out of range 
-	  return ~0U;	// Return invalid physical 0xFFF..F
-  }
-//LLamamos a la rutina de manejar page fault si no esta la pagina buscada
-  if (! S->pgt[page].present )
-	// Not present: trigger page fault exception 
-	  handle_page_fault(S, virtual_addr);
-
-  // Now it is present
-  frame = S->pgt[page].frame ;	// Obtienemos el marco físico desde la tabla de páginas.
-  physical_addr = frame*S->pagsz+offset; //Calculamos la dic fisica
-
-  reference_page (S, page, op);//Referenciamos la pagina
-//modo detallado
-  if (S->detailed) {
-	  printf ("\t %c %u==P %d(M %d)+ %d\n", op, virtual_addr, page, frame, offset);
-  }
-  
-  return physical_addr;
-}
-
-void reference_page(ssystem* S, int page, char op) {
+static void reference_page(ssystem* S, int page, char op) {
   if (op == 'R') {              // If it's a read,
     S->numrefsread++;           // count it
   } else if (op == 'W') {       // If it's a write,
-    S->pgt[page].modified = 1;  // count it and mark the
+    PAGE_MODIFIED(S, page) = 1; // count it and mark the
     S->numrefswrite++;          // page 'modified'
   }
 }
 
-// Functions that simulate the operating system
+static void reference_run(ssystem* S, int page,
+                          unsigned long long reads,
+                          unsigned long long writes) {
+  S->numrefsread += reads;
+  S->numrefswrite += writes;
 
-void handle_page_fault(ssystem* S, unsigned virtual_addr) {
-  int page, victim, frame, last;
-//Incrementamos el numero de page faults
-  S->numpagefaults ++;
-  //Calculamos el número de página que causó el fallo dividiendo la dirección virtual entre el tamaño de la página.
-  page = virtual_addr / S-> pagsz;
-  //Si esta modo detalle mostramos la pagina que lo causó.
-  if (S->detailed)
-	  printf ("@ PAGE_FAULT in P %d!\n", page);
-//Comprobamos si hay marcos libres
- if (S->listfree != -1) {
-    // Sacamos un marco libre de la lista circular.
-    last = S->listfree;
-    frame = S->frt[last].next;
-    if (frame == last) {
-        S->listfree = -1;  // La lista de libres queda vacía.
-    } else {
-        S->frt[last].next = S->frt[frame].next;  // Saltamos al siguiente marco libre.
-    }
-    occupy_free_frame(S, frame, page);  // Ocupamos el marco con la nueva página.
-} else {
-    // No hay marcos libres: seleccionamos un marco víctima.
-    victim = choose_page_to_be_replaced(S);
-    replace_page(S, victim, page);
+  if (writes)
+    PAGE_MODIFIED(S, page) = 1;
 }
 
+// Functions that simulate the operating system
 
-
-}
-
-static unsigned myrandom(unsigned from,  // <<--- random
-                         unsigned size) {
-  unsigned n;
-
-  n = from + (unsigned)(rand() / (RAND_MAX + 1.0) * size);
-
-  if (n > from + size - 1)  // These checks shouldn't
-    n = from + size - 1;    // be necessary, but it's
-  else if (n < from)        // better to not rely too
-    n = from;               // much on the floating
-                            // point operations
-  return n;
-}
-
-int choose_page_to_be_replaced(ssystem* S) {
+static int choose_page_to_be_replaced(ssystem* S) {
     int frame, victim;
 
     // El marco víctima es el que sigue al último en la lista circular.
@@ -143,10 +81,10 @@ int choose_page_to_be_replaced(ssystem* S) {
 }
 
 
-void replace_page(ssystem* S, int victim, int newpage) {
-    int frame = S->pgt[victim].frame;
+static void replace_page(ssystem* S, int victim, int newpage) {
+    int frame = PAGE_FRAME(S, victim);
 
-    if (S->pgt[victim].modified) {
+    if (PAGE_MODIFIED(S, victim)) {
         if (S->detailed)
             printf("@ Writing modified P%d back (to disc) to replace it\n", victim);
         S->numpgwriteback++;
@@ -156,16 +94,16 @@ void replace_page(ssystem* S, int victim, int newpage) {
         printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
 
     // Actualizamos la tabla de páginas.
-    S->pgt[victim].present = 0;
-    S->pgt[newpage].present = 1;
-    S->pgt[newpage].frame = frame;
-    S->pgt[newpage].modified = 0;
+    PAGE_PRESENT(S, victim) = 0;
+    PAGE_PRESENT(S, newpage) = 1;
+    PAGE_FRAME(S, newpage) = frame;
+    PAGE_MODIFIED(S, newpage) = 0;
 
     S->frt[frame].page = newpage;
 }
 
 
-void occupy_free_frame(ssystem* S, int frame, int page) {
+static void occupy_free_frame(ssystem* S, int frame, int page) {
     if (S->detailed) printf("@ Storing P%d in F%d\n", page, frame);
 
     // Si la lista de ocupados está vacía, inicializamos la lista.
@@ -179,29 +117,29 @@ void occupy_free_frame(ssystem* S, int frame, int page) {
     S->listoccupied = frame;  // Actualizamos el último marco ocupado.
 
     // Actualizamos la tabla de páginas y el marco.
-    S->pgt[page].present = 1;
-    S->pgt[page].frame = frame;
-    S->pgt[page].modified = 0;
+    PAGE_PRESENT(S, page) = 1;
+    PAGE_FRAME(S, page) = frame;
+    PAGE_MODIFIED(S, page) = 0;
     S->frt[frame].page = page;
 }
 
 
 // Functions that show results
 
-void print_page_table(ssystem* S) {
+static void print_page_table(ssystem* S) {
   int p;
 
   printf("%10s %10s %10s   %s\n", "PAGE", "Present", "Frame", "Modified");
 
   for (p = 0; p < S->numpags; p++)
-    if (S->pgt[p].present)
-      printf("%8d   %6d     %8d   %6d\n", p, S->pgt[p].present, S->pgt[p].frame,
-             S->pgt[p].modified);
+    if (PAGE_PRESENT(S, p))
+      printf("%8d   %6d     %8d   %6d\n", p, PAGE_PRESENT(S, p), PAGE_FRAME(S, p),
+             PAGE_MODIFIED(S, p));
     else
-      printf("%8d   %6d     %8s   %6s\n", p, S->pgt[p].present, "-", "-");
+      printf("%8d   %6d     %8s   %6s\n", p, PAGE_PRESENT(S, p), "-", "-");
 }
 
-void print_frames_table(ssystem* S) {
+static void print_frames_table(ssystem* S) {
   int p, f;
 
   printf("%10s %10s %10s   %s\n", "FRAME", "Page", "Present", "Modified");
@@ -211,17 +149,32 @@ void print_frames_table(ssystem* S) {
 
     if (p == -1)
       printf("%8d   %8s   %6s     %6s\n", f, "-", "-", "-");
-    else if (S->pgt[p].present)
-      printf("%8d   %8d   %6d     %6d\n", f, p, S->pgt[p].present,
-             S->pgt[p].modified);
+    else if (PAGE_PRESENT(S, p))
+      printf("%8d   %8d   %6d     %6d\n", f, p, PAGE_PRESENT(S, p),
+             PAGE_MODIFIED(S, p));
     else
-      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, S->pgt[p].present,
+      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, PAGE_PRESENT(S, p),
              "-");
   }
 }
 
-void print_replacement_report(ssystem* S) {
+static void print_replacement_report(ssystem* S) {
   printf(
       "FIFO"
       "(no specific information)\n");  // <<--- random
 }
+
+// Replacement policy
+
+const spolicy policy_fifo = {
+  "FIFO",
+  init_tables,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report
+};
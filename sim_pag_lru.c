@@ -12,11 +12,14 @@
 
 // Function that initialises the tables
 
-void init_tables(ssystem* S) {
+static void init_tables(ssystem* S) {
   int i;
 
   // Reset pages
-  memset(S->pgt, 0, sizeof(spage) * S->numpags);
+  clear_page_table(S);
+
+  // Split of addresses for this page size
+  init_translation(S);
 
   // Empty LRU stack
   S->lru = -1;
@@ -40,105 +43,45 @@ void init_tables(ssystem* S) {
 
 // Functions that simulate the hardware of the MMU
 
-unsigned sim_mmu(ssystem* S, unsigned virtual_addr, char op) {
-  unsigned physical_addr;
-  int page, frame, offset;
-
-  page   = virtual_addr / S-> pagsz ;	// Quotient 
-  offset = virtual_addr % S-> pagsz ;	// Reminder
-
-  if ( page <0 || page >= S->numpags )
-  {
-	  S->numillegalrefs++;  // References out of range 
-	  return ~0U;	// Return invalid physical 0xFFF..F
-  }
-
-  if (! S->pgt[page].present )
-	// Not present: trigger page fault exception 
-	  handle_page_fault(S, virtual_addr);
-
-  // Now it is present
-  frame = S->pgt[page].frame ;	
-  physical_addr = frame*S->pagsz+offset;
-
-  reference_page (S, page, op);
-
-  if (S->detailed) {
-	  printf ("\t %c %u==P %d(M %d)+ %d\n", op, virtual_addr, page, frame, offset);
-  }
-  
-  return physical_addr;
-}
-
-void reference_page(ssystem* S, int page, char op) {
+static void reference_page(ssystem* S, int page, char op) {
   if (op == 'R') {              // If it's a read,
     S->numrefsread++;           // count it
   } else if (op == 'W') {       // If it's a write,
-    S->pgt[page].modified = 1;  // count it and mark the
+    PAGE_MODIFIED(S, page) = 1; // count it and mark the
     S->numrefswrite++;          // page 'modified'
     }
-    S->pgt[page].timestamp = S->clock;//Actualizamos la marca de tiempo de la página
-    S->clock++;//Incrementamos
- //Control de overflow
-if(S->clock == 0)
-{
-  printf("Cuidadin que hay overflow del reloj :)");
-}
+    PAGE_TIMESTAMP(S, page) = S->clock;//Actualizamos la marca de tiempo de la página
+    S->clock++;//Incrementamos (64 bits: no hay overflow)
 }
 
-// Functions that simulate the operating system
+static void reference_run(ssystem* S, int page,
+                          unsigned long long reads,
+                          unsigned long long writes) {
+  S->numrefsread += reads;
+  S->numrefswrite += writes;
 
-void handle_page_fault(ssystem* S, unsigned virtual_addr) {
-  int page, victim, frame, last;
+  if (writes)
+    PAGE_MODIFIED(S, page) = 1;
 
-  S->numpagefaults ++;
-  page = virtual_addr / S-> pagsz;
-  if (S->detailed)
-	  printf ("@ PAGE_FAULT in P %d!\n", page);
-
- if (S->listfree != -1) {
-	// There are free frames
-	last = S->listfree;
-	frame = S->frt[last].next;
-	  if (frame==last) {
-		// Then, this is the last one left.
-		  S->listfree = -1;
-	  } else {
-		// Otherwise, bypass
-		  S->frt[last].next = S->frt[frame].next;			
-	  }
-	occupy_free_frame(S, frame, page);
-}
-else {
-	// There are not free frames
-	victim = choose_page_to_be_replaced(S);
-	replace_page(S, victim, page);
-}
-}
-static unsigned myrandom(unsigned from,  // <<--- random
-                         unsigned size) {
-  unsigned n;
-
-  n = from + (unsigned)(rand() / (RAND_MAX + 1.0) * size);
-
-  if (n > from + size - 1)  // These checks shouldn't
-    n = from + size - 1;    // be necessary, but it's
-  else if (n < from)        // better to not rely too
-    n = from;               // much on the floating
-                            // point operations
-  return n;
+  // Same marks as reads+writes calls to reference_page
+  S->clock += reads + writes;
+  PAGE_TIMESTAMP(S, page) = S->clock - 1;
 }
 
-int choose_page_to_be_replaced(ssystem* S) {
+// Functions that simulate the operating system
+
+static int choose_page_to_be_replaced(ssystem* S) {
   int frame = -1, victim;//Inicialización
 
 //buscamos la página con la marca de tiempo más baja
   for(int i = 0; i < S->numframes; i++){
     if(frame == -1)
       frame = i;
-    if(S->pgt[S->frt[i].page].timestamp < S->pgt[S->frt[frame].page].timestamp)
+    if(PAGE_TIMESTAMP(S, S->frt[i].page) < PAGE_TIMESTAMP(S, S->frt[frame].page))
       frame = i;
   }
+  STATS_SEARCH_COST(S, S->numframes);
+
   //La almacenamos
 
   victim = S->frt[frame].page;
@@ -152,12 +95,12 @@ int choose_page_to_be_replaced(ssystem* S) {
   return victim;
 }
 
-void replace_page(ssystem* S, int victim, int newpage) {
+static void replace_page(ssystem* S, int victim, int newpage) {
   int frame;
 
-  frame = S->pgt[victim].frame;
+  frame = PAGE_FRAME(S, victim);
 
-  if (S->pgt[victim].modified) {
+  if (PAGE_MODIFIED(S, victim)) {
     if (S->detailed)
       printf(
           "@ Writing modified P%d back (to disc) to "
@@ -170,41 +113,105 @@ void replace_page(ssystem* S, int victim, int newpage) {
   if (S->detailed)
     printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
 
-  S->pgt[victim].present = 0;
+  PAGE_PRESENT(S, victim) = 0;
 
-  S->pgt[newpage].present = 1;
-  S->pgt[newpage].frame = frame;
-  S->pgt[newpage].modified = 0;
+  PAGE_PRESENT(S, newpage) = 1;
+  PAGE_FRAME(S, newpage) = frame;
+  PAGE_MODIFIED(S, newpage) = 0;
 
   S->frt[frame].page = newpage;
 }
 
-void occupy_free_frame(ssystem* S, int frame, int page) {
+static void occupy_free_frame(ssystem* S, int frame, int page) {
   if (S->detailed) printf("@ Storing P%d in F%d\n", page, frame);
 
-  S->pgt[page].frame = frame;
+  PAGE_FRAME(S, page) = frame;
   S->frt[frame].page = page;
 
-  S->pgt[page].present = 1;
-  S->pgt[page].referenced = 1;
+  PAGE_PRESENT(S, page) = 1;
+  PAGE_REFERENCED(S, page) = 1;
+}
+
+// Exact LRU with a recency list: the occupied frames form a
+// circular doubly-linked list (sframe.next/prev) where S->lru
+// is the least recently used frame and its prev the most
+// recently used one. Each reference moves its frame to the
+// MRU end and the victim is always S->lru, so both are O(1).
+// Timestamps are still kept, so tables and reports are the
+// same as with the scan above.
+
+static void make_mru(ssystem* S, int frame) {
+  int lru = S->lru;
+
+  if (frame == lru) {
+    S->lru = S->frt[frame].next;  // Rotating makes it the MRU
+  } else if (S->frt[lru].prev != frame) {
+    // Unlink it...
+    S->frt[S->frt[frame].prev].next = S->frt[frame].next;
+    S->frt[S->frt[frame].next].prev = S->frt[frame].prev;
+
+    // ...and insert it between the MRU and the LRU
+    S->frt[frame].prev = S->frt[lru].prev;
+    S->frt[frame].next = lru;
+    S->frt[S->frt[lru].prev].next = frame;
+    S->frt[lru].prev = frame;
+  }
+}
+
+static void reference_page_list(ssystem* S, int page, char op) {
+  reference_page(S, page, op);
+  make_mru(S, PAGE_FRAME(S, page));
+}
+
+static void reference_run_list(ssystem* S, int page,
+                               unsigned long long reads,
+                               unsigned long long writes) {
+  reference_run(S, page, reads, writes);
+  make_mru(S, PAGE_FRAME(S, page));
+}
+
+static int choose_page_to_be_replaced_list(ssystem* S) {
+  int frame = S->lru, victim = S->frt[frame].page;
+
+  if (S->detailed)
+    printf(
+        "@ Choosing (at LRU) P%d of F%d to be "
+        "replaced\n",
+        victim, frame);
+
+  return victim;
+}
+
+static void occupy_free_frame_list(ssystem* S, int frame, int page) {
+  occupy_free_frame(S, frame, page);
+
+  if (S->lru == -1) {
+    S->frt[frame].next = S->frt[frame].prev = frame;
+    S->lru = frame;
+  } else {  // Insert it as the MRU
+    S->frt[frame].prev = S->frt[S->lru].prev;
+    S->frt[frame].next = S->lru;
+    S->frt[S->frt[S->lru].prev].next = frame;
+    S->frt[S->lru].prev = frame;
+  }
 }
 
 // Functions that show results
 
-void print_page_table(ssystem* S) {
+static void print_page_table(ssystem* S) {
   int p;
 
   printf("%10s %10s %10s %10s   %s\n", "PAGE", "Present", "Frame", "Modified", "Timestamp");
 
   for (p = 0; p < S->numpags; p++)
-    if (S->pgt[p].present)
-      printf("%8d   %6d     %8d   %6d   %8d\n", p, S->pgt[p].present, S->pgt[p].frame,
-             S->pgt[p].modified, S->pgt[p].timestamp);
+    if (PAGE_PRESENT(S, p))
+      printf("%8d   %6d     %8d   %6d   %8llu\n", p, PAGE_PRESENT(S, p), PAGE_FRAME(S, p),
+             PAGE_MODIFIED(S, p), PAGE_TIMESTAMP(S, p));
     else
-      printf("%8d   %6d     %8s   %6s   %8d\n", p, S->pgt[p].present, "-", "-", S->pgt[p].timestamp);
+      printf("%8d   %6d     %8s   %6s   %8llu\n", p, PAGE_PRESENT(S, p), "-", "-", PAGE_TIMESTAMP(S, p));
 }
 
-void print_frames_table(ssystem* S) {
+static void print_frames_table(ssystem* S) {
   int p, f;
 
   printf("%10s %10s %10s   %s\n", "FRAME", "Page", "Present", "Modified");
@@ -214,31 +221,56 @@ void print_frames_table(ssystem* S) {
 
     if (p == -1)
       printf("%8d   %8s   %6s     %6s\n", f, "-", "-", "-");
-    else if (S->pgt[p].present)
-      printf("%8d   %8d   %6d     %6d\n", f, p, S->pgt[p].present,
-             S->pgt[p].modified);
+    else if (PAGE_PRESENT(S, p))
+      printf("%8d   %8d   %6d     %6d\n", f, p, PAGE_PRESENT(S, p),
+             PAGE_MODIFIED(S, p));
     else
-      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, S->pgt[p].present,
+      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, PAGE_PRESENT(S, p),
              "-");
   }
 }
 
-void print_replacement_report(ssystem* S) {
-  //Inicializamos las variables
-  int mintimestamp, maxtimestamp;
-  for(int i = 0; i < S->numpags; i++){
-    if(i == 0){
-      mintimestamp = S->pgt[i].timestamp;
-      maxtimestamp = S->pgt[i].timestamp;
-    }
-    if(S->pgt[i].timestamp < mintimestamp)
-      mintimestamp = S->pgt[i].timestamp;
-    if(S->pgt[i].timestamp > maxtimestamp)
-      maxtimestamp = S->pgt[i].timestamp;
+static void print_replacement_report(ssystem* S) {
+  //Inicializamos las variables con la primera página
+  unsigned long long mintimestamp = PAGE_TIMESTAMP(S, 0);
+  unsigned long long maxtimestamp = PAGE_TIMESTAMP(S, 0);
+  for(int i = 1; i < S->numpags; i++){
+    if(PAGE_TIMESTAMP(S, i) < mintimestamp)
+      mintimestamp = PAGE_TIMESTAMP(S, i);
+    if(PAGE_TIMESTAMP(S, i) > maxtimestamp)
+      maxtimestamp = PAGE_TIMESTAMP(S, i);
   }
 
 
   printf(
       "LRU replacement "
-      "(Clock value: %10d, Min timestamp: %10d, Max timestamp: %10d)\n", S->clock, mintimestamp, maxtimestamp);  
-}
\ No newline at end of file
+      "(Clock value: %10llu, Min timestamp: %10llu, Max timestamp: %10llu)\n", S->clock, mintimestamp, maxtimestamp);  
+}
+
+// Replacement policy
+
+const spolicy policy_lru = {
+  "LRU",
+  init_tables,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report
+};
+
+const spolicy policy_lru_list = {
+  "LRU list",
+  init_tables,
+  reference_page_list,
+  reference_run_list,
+  choose_page_to_be_replaced_list,
+  replace_page,
+  occupy_free_frame_list,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report
+};
@@ -0,0 +1,441 @@
+/*
+    sim_pag_lru_curve.c
+*/
+
+// Computes, in a single pass over the trace, the page faults
+// (and write backs) that LRU replacement would cause with
+// every possible number of frames.
+//
+// LRU has the inclusion property: the pages held by n frames
+// are always among those held by n+1 frames. So each
+// reference has a stack distance d (its depth in the LRU
+// stack, i.e., 1 + # of distinct pages referenced since the
+// previous reference to the same page) and it causes a page
+// fault with n frames if and only if n < d (Mattson et al.).
+//
+// The distances are computed with a Fenwick tree indexed by
+// time, that holds a 1 in the time of the last reference to
+// each page. When the tree is full, the marks are compacted
+// while keeping their order. Each reference costs O(log N).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracegen.h"
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagsz, maxframes;
+    const char * algorithm, * initialstate;
+    int numelem;
+}
+sparameters;
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char*[], sparameters*);
+
+// Structure that holds the state of the stack distance
+// analysis
+
+typedef struct
+{
+    unsigned pagsz;           // Page size (in elements)
+    unsigned numpags;         // # of pages
+    unsigned infinite;        // numpags+1, "infinite" distance
+    int * last;               // Time of last ref. to each page
+    int * owner;              // Page last referenced at each time
+    int * tree;               // Fenwick tree over time
+    unsigned capacity;        // # of times in the tree
+    unsigned now;             // Current time
+
+    // Histogram of distances (-> page faults)
+    unsigned long long * hist;    // hist[d], 1<=d<=numpags
+    unsigned long long coldrefs;  // First references to pages
+
+    // Write backs: with n frames, the copy of page p in
+    // memory is modified if and only if n >= dirty[p]
+    unsigned * dirty;
+    long long * wbdiff;       // Difference array of write backs
+
+    unsigned long long numrefsread, numrefswrite, numillegalrefs;
+}
+sstack;
+
+// Functions that handle the stack distance analysis
+
+int create_stack (sstack *, unsigned pagsz, unsigned numpags);
+void free_stack (sstack *);
+void reference_page (sstack *, unsigned page, char op);
+void print_curve (sstack *, int maxframes);
+
+// Function that receives the operations of the trace (its
+// first parameter points to the sstack)
+
+function_sink reference_access;
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    ssource T;          // Where the trace comes from
+    int ok;             // Flag
+    unsigned numpags;   // Total number of pages
+    sstack K;           // State of the LRU stack
+
+    memset (&K, 0, sizeof(K));
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %i %s %s %i %i\n",
+            argv[0], P.pagsz, P.algorithm, P.initialstate,
+            P.numelem, P.maxframes);
+
+    // Prepare the trace
+    ok = source_open (&T, P.algorithm, P.initialstate, P.numelem);
+
+    printf ("# Trace:  %s\n", T.name);
+
+    if (ok)
+    {
+        // Calculate total number of pages
+        numpags = (T.totalsz+P.pagsz-1) / P.pagsz;
+
+        if (create_stack(&K,P.pagsz,numpags)<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        ok = source_run (&T, reference_access, &K);
+
+    if (ok)
+        print_curve (&K, P.maxframes);
+
+    source_close (&T);
+
+    free_stack (&K);
+
+    return ok ? 0 : -1;
+}
+
+// Functions of the Fenwick tree (positions start at 1)
+
+static void tree_add (sstack * pK, unsigned pos, int v)
+{
+    for (; pos<=pK->capacity; pos+=pos&-pos)
+        pK->tree[pos] += v;
+}
+
+static int tree_sum (sstack * pK, unsigned pos)
+{
+    int sum;
+
+    for (sum=0; pos; pos-=pos&-pos)
+        sum += pK->tree[pos];
+
+    return sum;
+}
+
+// Renumbers the last references to keep only the live times,
+// in the same order, at the beginning of the tree
+
+static void compact_times (sstack * pK)
+{
+    unsigned t, n, pos;
+    int page;
+
+    memset (pK->tree, 0, (pK->capacity+1)*sizeof(int));
+
+    for (t=1, n=0; t<pK->now; t++)
+        if ((page=pK->owner[t]) >= 0 && pK->last[page]==t)
+        {
+            n ++;
+            pK->owner[n] = page;
+            pK->last[page] = n;
+        }
+
+    for (t=n+1; t<=pK->capacity; t++)
+        pK->owner[t] = -1;
+
+    // Times 1..n hold a 1: build the tree in O(N)
+    for (pos=1; pos<=pK->capacity; pos++)
+    {
+        if (pos<=n)
+            pK->tree[pos] += 1;
+
+        if (pos+(pos&-pos) <= pK->capacity)
+            pK->tree[pos+(pos&-pos)] += pK->tree[pos];
+    }
+
+    pK->now = n+1;
+}
+
+// Functions that handle the stack distance analysis
+
+int create_stack (sstack * pK, unsigned pagsz, unsigned numpags)
+{
+    unsigned u;
+
+    pK->pagsz = pagsz;
+    pK->numpags = numpags;
+    pK->infinite = numpags+1;
+    pK->capacity = 2*numpags + 16;
+    pK->now = 1;
+    pK->coldrefs = 0;
+    pK->numrefsread = pK->numrefswrite = pK->numillegalrefs = 0;
+
+    pK->last = (int*) malloc (numpags*sizeof(int));
+    pK->dirty = (unsigned*) malloc (numpags*sizeof(unsigned));
+    pK->owner = (int*) malloc ((pK->capacity+1)*sizeof(int));
+    pK->tree = (int*) calloc (pK->capacity+1, sizeof(int));
+    pK->hist = (unsigned long long*)
+               calloc (numpags+2, sizeof(unsigned long long));
+    pK->wbdiff = (long long*) calloc (numpags+2, sizeof(long long));
+
+    if (!pK->last || !pK->dirty || !pK->owner || !pK->tree ||
+        !pK->hist || !pK->wbdiff)
+        return -1;
+
+    for (u=0; u<numpags; u++)
+    {
+        pK->last[u] = -1;
+        pK->dirty[u] = pK->infinite;
+    }
+
+    for (u=0; u<=pK->capacity; u++)
+        pK->owner[u] = -1;
+
+    return 0;
+}
+
+void free_stack (sstack * pK)
+{
+    free (pK->last);
+    free (pK->dirty);
+    free (pK->owner);
+    free (pK->tree);
+    free (pK->hist);
+    free (pK->wbdiff);
+}
+
+void reference_access (void * p, char op, unsigned pos)
+{
+    sstack * pK = (sstack*) p;
+
+    if (op!='C')          // 'C'omparisons do not access memory
+        reference_page (pK, pos/pK->pagsz, op);
+}
+
+void reference_page (sstack * pK, unsigned page, char op)
+{
+    unsigned d;
+
+    if (page >= pK->numpags)
+    {
+        pK->numillegalrefs ++;
+        return;
+    }
+
+    if (op=='W')
+        pK->numrefswrite ++;
+    else
+        pK->numrefsread ++;
+
+    if (pK->now > pK->capacity)
+        compact_times (pK);
+
+    if (pK->last[page] < 0)  // First reference: always a fault
+    {
+        d = pK->infinite;
+        pK->coldrefs ++;
+    }
+    else
+    {
+        d = tree_sum(pK,pK->now-1) - tree_sum(pK,pK->last[page]) + 1;
+        pK->hist[d] ++;
+        tree_add (pK, pK->last[page], -1);
+    }
+
+    // With dirty[page] <= n < d frames, the page was evicted
+    // while modified (with fewer, it was clean; with more, it
+    // was not evicted)
+    if (pK->dirty[page] < d)
+    {
+        pK->wbdiff[pK->dirty[page]] ++;
+        pK->wbdiff[d] --;
+    }
+
+    // With n < d frames the page has just been loaded again
+    if (op=='W')
+        pK->dirty[page] = 1;
+    else if (pK->dirty[page] < d)
+        pK->dirty[page] = d;
+
+    tree_add (pK, pK->now, 1);
+    pK->owner[pK->now] = page;
+    pK->last[page] = pK->now++;
+}
+
+void print_curve (sstack * pK, int maxframes)
+{
+    unsigned n, page, d;
+    unsigned long long faults;
+    long long writebacks;
+
+    // Pages evicted after their last reference are also
+    // written back if they were modified
+    for (page=0; page<pK->numpags; page++)
+        if (pK->last[page] >= 0)
+        {
+            d = tree_sum(pK,pK->now-1) - tree_sum(pK,pK->last[page]) + 1;
+
+            if (pK->dirty[page] < d)
+            {
+                pK->wbdiff[pK->dirty[page]] ++;
+                pK->wbdiff[d] --;
+            }
+
+            pK->dirty[page] = pK->infinite;  // Already counted
+        }
+
+    if (maxframes<=0 || maxframes>pK->numpags)
+        maxframes = pK->numpags;
+
+    printf ("# Read references:  %llu\n", pK->numrefsread);
+    printf ("# Write references: %llu\n", pK->numrefswrite);
+
+    if (pK->numillegalrefs)
+        printf ("# WARNING: %llu REFERENCES OUT OF RANGE\n",
+                pK->numillegalrefs);
+
+    printf ("frames,faults,writebacks\n");
+
+    // Faults with n frames: cold ones plus those at distance > n
+    for (d=1, faults=pK->coldrefs; d<=pK->numpags; d++)
+        faults += pK->hist[d];
+
+    for (n=1, writebacks=0; n<=maxframes; n++)
+    {
+        faults -= pK->hist[n];
+        writebacks += pK->wbdiff[n];
+        printf ("%u,%llu,%lld\n", n, faults, writebacks);
+    }
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok;
+
+    // Default parameters
+    p->pagsz = 16;
+    p->maxframes = 0;
+    p->algorithm = "MER";
+    p->initialstate = "RAN";
+    p->numelem = 1000;
+
+    if (argc>6)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        ok = 1;
+
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
+                       p->pagsz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->algorithm = argv[2];
+
+        if (strcmp(p->algorithm,"-") && !source_is_file(p->algorithm) &&
+            (strlen(p->algorithm)!=3 ||
+             strchr(p->algorithm,'/') ||
+             !strstr(VALID_ALGORITHMS,p->algorithm)))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->initialstate = argv[3];
+
+        if (strlen(p->initialstate)!=3 ||
+            strchr(p->initialstate,'/') ||
+            !strstr(VALID_INIT_ORD,p->initialstate))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial state");
+            ok = 0;
+        }
+
+        if (argc>4 && (sscanf(argv[4],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements");
+            ok = 0;
+        }
+
+        if (argc>5 && (sscanf(argv[5],"%d",&p->maxframes)!=1 ||
+                       p->maxframes<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong maximum number of "
+                                  "frames");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n\n    USAGE:\n\t%s pagesize alg initord "
+                          "numelem maxframes\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tpagesize: # of elements that fit in a page\n"
+             "\talg: sorting algorithm (%s),\n"
+             "\t     or - to read a trace from the standard input,\n"
+             "\t     or the name of a file with a trace (with a / or a .)\n"
+             "\tinitord: initial state of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\tmaxframes: largest # of page frames shown "
+                          "(default: # of pages)\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 16 MER RAN 1000\n"
+             "\t%s 1 HEA DES 100 10\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
@@ -5,8 +5,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "sim_paging.h"
+#include "tracegen.h"
+
+// Replacement policy simulated by this binary (each
+// sim_pag_* binary compiles this file with its own one)
+
+#ifndef SIM_POLICY
+#define SIM_POLICY policy_random
+#endif
+
+// With statistics (see sim_paging.h), the trace is always
+// loaded in memory before the simulation, so that the time
+// spent taking it is measured apart. They are written as JSON
+// to the standard error.
+
+#ifdef SIM_STATS
+#define PRELOAD_TRACE 1
+#else
+#define PRELOAD_TRACE 0
+#endif
 
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
@@ -16,7 +39,12 @@ typedef struct
     int pagsz, numframes;
     const char * algorithm, * initialstate;
     int numelem;
-    char detailed;
+    char detailed;      // Mode D
+    char compressed;    // Mode C: references folded into runs
+    char events;        // Mode E: event log
+    const char * evfile;        // Where the event log goes
+    unsigned long long t0, t1;  // Filters of the event log
+    char faultsonly;
 }
 sparameters;
 
@@ -24,22 +52,52 @@ sparameters;
 // command line:
 
 int parse_command (int, char*[], sparameters*);
+int parse_filter (const char *, sparameters*);
+
+// Functions that receive the operations of the trace, an array
+// at a time (the second one, in mode C, through an srun)
+
+function_batch_sink simulate_batch, simulate_batch_run;
+
+typedef struct
+{
+    ssystem * S;
+    srun R;
+}
+srunsystem;
+
+// Function that sends to pbatch a trace loaded in memory
+
+void replay_references (const sreferences *,
+                        function_batch_sink * pbatch, void * pctx);
+
+// Function that returns the time in seconds
+
+double now (void);
 
 // Main function
 
 int main (int argc, char * argv[])
 {
     sparameters P;      // Parameters received in the command line
-    char command[100];  // Command for executing gen_trace
-    FILE * pipe;        // Communication channel with gen_trace
+    ssource T;          // Where the trace comes from
     int ok;             // Flag
-    char op;            // Elementary operation ('R'ead, 'W'ri..)
-    unsigned u;         // Number of the read/written element
-    unsigned numpags;   // Total number of pages
-    unsigned totelem;   // Total num. of elements (double in MER)
+    int numpags;        // Total number of pages
     ssystem S;          // State of the whole simulated system
+    srunsystem RS;      // Runs of references in mode C
+    sreferences R;      // Trace loaded in advance (only for OPT)
+    sevlog * L;         // Event log in mode E
+    int fd;
+    function_batch_sink * pbatch;  // Where the references go
+    void * pctx;
+#ifdef SIM_STATS
+    double t = now ();          // Start of a phase
+#endif
 
     memset (&S, 0, sizeof(S));  // Reset system
+    R.refs = NULL;
+    L = NULL;
+    fd = -1;
 
     if (parse_command(argc,argv,&P)<0)  // Put parameters in P
         return -1;
@@ -47,37 +105,36 @@ int main (int argc, char * argv[])
     printf ("# Parameters:  %s %i %i %s %s %i %c\n",
             argv[0], P.pagsz, P.numframes,
             P.algorithm, P.initialstate, P.numelem,
-            P.detailed?'D':'N');
-
-    // Prepare command for invoking gen_trace
-    // (sprintf "prints" in a string)
-    sprintf (command, "./gen_trace %s %s %u",
-                      P.algorithm, P.initialstate, P.numelem);
-
-    printf ("# Executing command:  %s\n", command);
-
-    // Invoke gen_trace and open a pipe to read
-    // its standard output ("r" stands for read)
-    pipe = popen (command, "r");
+            P.detailed?'D':P.compressed?'C':P.events?'E':'N');
 
-    if (!pipe)
-    {
-        perror ("ERROR while starting gen_trace");
-        return -1;
-    }
+    // Prepare the trace: it is generated in this process by
+    // the code of gen_trace (or read from the standard input)
+    ok = source_open (&T, P.algorithm, P.initialstate, P.numelem);
 
-    // Read total # of elements to be sorted
-    ok = fscanf (pipe," T %u", &totelem) == 1;
+    printf ("# Trace:  %s\n", T.name);
 
     if (ok)
     {
-        // Calculate total number of pages
-        numpags = (totelem+P.pagsz-1) / P.pagsz; 
+        // Calculate total number of pages (fewer, if some of
+        // them are huge)
+        numpags = (T.totalsz+P.pagsz-1) / P.pagsz;
+        S.pagsz = P.pagsz;
+
+        if (getenv(HUGE_ENV) &&
+            (numpags = huge_create (&S, getenv(HUGE_ENV),
+                                    T.totalsz)) < 0)
+        {
+            fprintf (stderr,
+                     "ERROR: Wrong huge pages \"%s\" (must be "
+                     "factor[:start], with factor > 1)\n",
+                     getenv(HUGE_ENV));
+            ok = 0;
+        }
 
-        S.pgt = (spage*) malloc (numpags*sizeof(spage));
+        S.numpags = numpags;
         S.frt = (sframe*) malloc (P.numframes*sizeof(sframe));
 
-        if (!S.pgt || !S.frt)
+        if (ok && (alloc_page_table(&S)<0 || !S.frt))
         {
             fprintf (stderr,
                      "ERROR: not enough "
@@ -88,87 +145,262 @@ int main (int argc, char * argv[])
 
     if (ok)
     {
-        S.pagsz = P.pagsz;
-        S.numpags = numpags;
         S.numframes = P.numframes;
         S.detailed = P.detailed;
+        S.policy = &SIM_POLICY;
 
-        init_tables (&S);
+        // The TLB and the radix page table, if asked for, are
+        // emptied by init_tables
+        if (getenv(TLB_ENV) && tlb_create (&S, getenv(TLB_ENV))<0)
+        {
+            fprintf (stderr,
+                     "ERROR: Wrong TLB \"%s\" (must be "
+                     "entries[:ways[:lru|random]], with ways "
+                     "dividing entries)\n", getenv(TLB_ENV));
+            ok = 0;
+        }
+        else if (getenv(PGTABLE_ENV) &&
+                 pgt_create (&S, getenv(PGTABLE_ENV))<0)
+        {
+            fprintf (stderr,
+                     "ERROR: Wrong page table \"%s\" (must be "
+                     "levels[:bits], with 1 to %d levels that "
+                     "cover the pages in 32 bits)\n",
+                     getenv(PGTABLE_ENV), PGT_MAX_LEVELS);
+            ok = 0;
+        }
+        else
+            S.policy->init_tables (&S);
     }
 
-    while (ok)
+    if (ok && P.events)
     {
-        // Ignore spaces and read one character
-        if (fscanf(pipe," %c",&op)!=1)
+        // The log is big (it has its own buffer)
+        if (!(L = (sevlog*) malloc (sizeof(sevlog))))
         {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
             ok = 0;
-            break;
         }
-
-        if (op=='R' || op=='W')              // If R/W,
-        {                                    // take element
-            if (fscanf(pipe,"%u",&u)!=1)     // number and
-                ok = 0;                      // annotate
-            else
-                sim_mmu (&S, u, op);  // Simulate memory access
+        else if ((fd = open (P.evfile,O_WRONLY|O_CREAT|O_TRUNC,
+                             0644))<0 || evlog_open (L,fd,&S)<0)
+        {
+            fprintf (stderr, "ERROR: could not write "
+                             "the event log %s\n", P.evfile);
+            ok = 0;
         }
-        else if (op=='S')        // 'S'orted -> end
-            break;               // 'C'omparison -> go on
-        else if (op!='C')        // 'O'ut of order (or
-            ok = 0;              // something else) -> error
+        else
+        {
+            L->t0 = P.t0;
+            L->t1 = P.t1;
+            L->faultsonly = P.faultsonly;
+            S.evlog = L;
+        }
+    }
+
+    // Policies that need to know the future get the whole trace
+    // before the simulation, which then runs from memory
+    if (ok && (PRELOAD_TRACE || S.policy->prepare_trace))
+    {
+        ok = load_references (&R, &T);
+
+        if (ok==1 && S.policy->prepare_trace &&
+            S.policy->prepare_trace(&S,R.refs,R.numrefs)<0)
+            ok = -1;
+
+        if (ok<0)
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+
+        ok = ok==1;
+    }
+
+#ifdef SIM_STATS
+    S.stats.tracetime = now () - t;
+    t = now ();
+#endif
+
+    // Simulate every memory access of the trace
+    if (P.compressed)
+    {
+        RS.S = &S;
+        run_start (&RS.R);
+        pbatch = simulate_batch_run;
+        pctx = &RS;
+    }
+    else
+    {
+        pbatch = simulate_batch;
+        pctx = &S;
+    }
+
+    if (ok && R.refs)
+        replay_references (&R, pbatch, pctx);
+    else if (ok)
+        ok = source_run_batch (&T, pbatch, pctx);
+
+    if (ok && P.compressed)
+        run_flush (&S, &RS.R);   // The last run
+
+#ifdef SIM_STATS
+    S.stats.simtime = now () - t;
+#endif
+
+    if (ok && L && evlog_close(L)<0)
+    {
+        fprintf (stderr, "ERROR: could not write "
+                         "the event log %s\n", P.evfile);
+        ok = 0;
     }
 
     if (ok)
         print_report (&S);
 
-    // Wait until gen_trace ends and close
-    if (pclose(pipe)==-1)
-        ok = 0;
+#ifdef SIM_STATS
+    if (ok)
+        print_stats (&S, stderr);
+#endif
+
+    source_close (&T);
 
     // Free dynamic memory
-    free (S.pgt);
+    free_references (&R);
+    free_page_table (&S);
     free (S.frt);
+    free (L);
+
+    if (fd>=0)
+        close (fd);
 
     return ok ? 0 : -1;
 }
 
+// Function that receives the operations of the trace
+
+void simulate_batch (void * p, const unsigned * refs, unsigned n)
+{
+    unsigned u;
+
+    for (u=0; u<n; u++)
+        if (TRACE_REF_OP(refs[u])!='C')   // 'C'omparisons do not
+            sim_mmu (p, TRACE_REF_POS(refs[u]),  // access memory
+                     TRACE_REF_OP(refs[u]));
+}
+
+void simulate_batch_run (void * p, const unsigned * refs, unsigned n)
+{
+    srunsystem * pRS = (srunsystem*) p;
+    unsigned u;
+
+    for (u=0; u<n; u++)
+        if (TRACE_REF_OP(refs[u])!='C')
+            run_reference (pRS->S, &pRS->R, TRACE_REF_POS(refs[u]),
+                           TRACE_REF_OP(refs[u]));
+}
+
+double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+void replay_references (const sreferences * pR,
+                        function_batch_sink * pbatch, void * pctx)
+{
+    size_t u, n;
+
+    // In slices, since a batch is counted in unsigned
+    for (u=0; u<pR->numrefs; u+=n)
+    {
+        n = pR->numrefs-u < 1U<<30 ? pR->numrefs-u : 1U<<30;
+        pbatch (pctx, pR->refs+u, n);
+    }
+}
+
 // Function that shows the results
 
 void print_report (ssystem * S)
 {
+    unsigned long long tables;
+    int l;
+
     printf ("\n---------- GENERAL REPORT ----------\n\n");
 
-    printf ("Read references:          %d\n", S->numrefsread);
-    printf ("Write references:         %d\n", S->numrefswrite);
-    printf ("Page faults:              %d\n", S->numpagefaults);
-    printf ("Page dumps to disc:       %d\n", S->numpgwriteback);
+    printf ("Read references:          %llu\n", S->numrefsread);
+    printf ("Write references:         %llu\n", S->numrefswrite);
+    printf ("Page faults:              %llu\n", S->numpagefaults);
+    printf ("Page dumps to disc:       %llu\n", S->numpgwriteback);
+
+    if (S->policy->page_fault && S->numrefsread+S->numrefswrite)
+        printf ("Average frames used:      %.2f (frames x refs.: "
+                "%llu)\n", (double) S->framerefs /
+                (S->numrefsread+S->numrefswrite), S->framerefs);
+
+    if (S->tlb)
+    {
+        printf ("TLB (%d sets x %d ways, %s): %llu hits, %llu "
+                "misses, %llu invalidations\n", S->tlb->numsets,
+                S->tlb->ways, S->tlb->random?"random":"LRU",
+                S->tlb->hits, S->tlb->misses,
+                S->tlb->invalidations);
+
+        if (S->tlb->hits+S->tlb->misses)
+            printf ("TLB hit rate:             %.2f%%\n", 100.0 *
+                    S->tlb->hits / (S->tlb->hits+S->tlb->misses));
+    }
+
+    if (S->hugesz)
+        printf ("Huge pages:               %d of %d elements (from "
+                "P %d, at %u)\n", S->numpags-S->hugefirst,
+                S->hugesz, S->hugefirst, S->hugestart);
+
+    if (S->radix)
+    {
+        for (l=0, tables=0; l<S->radix->levels; l++)
+            tables += S->radix->numtables[l];
+
+        printf ("Radix page table:         %d levels of %d bits, "
+                "%llu tables, %llu bytes (flat: %llu)\n",
+                S->radix->levels, S->radix->bits, tables,
+                (tables << S->radix->bits) * PGT_ENTRY_BYTES,
+                (unsigned long long) S->numpags * PGT_ENTRY_BYTES);
+
+        if (S->radix->walks)
+            printf ("Page table walks:         %llu (%llu memory "
+                    "accesses, %.2f per walk)\n", S->radix->walks,
+                    S->radix->accesses, (double)
+                    S->radix->accesses / S->radix->walks);
+    }
 
     if (S->numillegalrefs)
-        printf ("\nWARNING: %d REFERENCES OUT OF RANGE\n",
+        printf ("\nWARNING: %llu REFERENCES OUT OF RANGE\n",
                 S->numillegalrefs);
                          
     printf ("\n---------- PAGES TABLE ---------\n\n");
 
-    print_page_table (S);
+    S->policy->print_page_table (S);
 
     printf ("\n---------- FRAMES TABLE ----------\n\n");
 
-    print_frames_table (S);
+    S->policy->print_frames_table (S);
 
     printf ("\n--------- REPLACEMENT REPORT ---------\n\n");
 
-    print_replacement_report (S);
+    S->policy->print_replacement_report (S);
 
     printf ("\n-------------------------------------\n\n");
-    printf ("PAGE FAULTS: --->> %d <<---\n\n",
+    printf ("PAGE FAULTS: --->> %llu <<---\n\n",
             S->numpagefaults);
 }
 
 // Function that parses the parameters received through the
 // command line:
 
-#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
-#define VALID_INIT_ORD "ASC/DES/RAN"
 
 int parse_command (int argc, char * argv[], sparameters * p)
 {
@@ -181,8 +413,12 @@ int parse_command (int argc, char * argv[], sparameters * p)
     p->initialstate = "RAN";
     p->numelem = 1000;
     p->detailed = 0;
+    p->compressed = 0;
+    p->events = 0;
+    p->evfile = "events.sev";
+    parse_filter ("all", p);
 
-    if (argc>7)
+    if (argc>9)
     {
         fprintf (stderr,
                  "\n    ERROR: too many parameters");
@@ -211,9 +447,10 @@ int parse_command (int argc, char * argv[], sparameters * p)
         if (argc>3)
             p->algorithm = argv[3];
 
-        if (strlen(p->algorithm)!=3 ||
-            strchr(p->algorithm,'/') ||
-            !strstr(VALID_ALGORITHMS,p->algorithm))
+        if (strcmp(p->algorithm,"-") && !source_is_file(p->algorithm) &&
+            (strlen(p->algorithm)!=3 ||
+             strchr(p->algorithm,'/') ||
+             !strstr(VALID_ALGORITHMS,p->algorithm)))
         {
             fprintf (stderr,
                      "\n    ERROR: wrong algorithm");
@@ -243,7 +480,8 @@ int parse_command (int argc, char * argv[], sparameters * p)
 
         if (argc>6)
         {
-            if (strcmp(argv[6],"N") && strcmp(argv[6],"D"))
+            if (strcmp(argv[6],"N") && strcmp(argv[6],"D") &&
+                strcmp(argv[6],"C") && strcmp(argv[6],"E"))
             {
                 fprintf (stderr,
                          "\n    ERROR: wrong mode");
@@ -251,6 +489,26 @@ int parse_command (int argc, char * argv[], sparameters * p)
             }
 
             p->detailed = !strcmp(argv[6],"D");
+            p->compressed = !strcmp(argv[6],"C");
+            p->events = !strcmp(argv[6],"E");
+        }
+
+        if (argc>7 && !p->events)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: evfile and filter are only "
+                                  "for mode E");
+            ok = 0;
+        }
+
+        if (argc>7)
+            p->evfile = argv[7];
+
+        if (argc>8 && parse_filter(argv[8],p)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong filter");
+            ok = 0;
         }
     }
 
@@ -259,15 +517,27 @@ int parse_command (int argc, char * argv[], sparameters * p)
 
     fprintf (stderr,
              "\n\n    USAGE:\n\t%s pagesize numframes alg "
-                          "initord numelem mode\n\n", argv[0]);
+                          "initord numelem mode [evfile [filter]]\n\n",
+             argv[0]);
 
     fprintf (stderr,
              "\tpagesize: # of elements that fit in a page\n"
              "\tnumframes: # of page frames (physical mem.)\n"
-             "\talg: sorting algorithm (%s)\n"
+             "\talg: sorting algorithm (%s),\n"
+             "\t     or - to read a trace from the standard input,\n"
+             "\t     or the name of a file with a trace (with a / or a .)\n"
              "\tinitord: initial state of the array (%s)\n"
              "\tnumelem: # of elements to be sorted\n"
-             "\tmode: normal(N) or detailed(D)\n"
+             "\tmode: normal(N), detailed(D), compressed(C),\n"
+             "\t     which simulates each run of references to\n"
+             "\t     the same page at once (same results as N),\n"
+             "\t     or event log(E), which writes what D shows\n"
+             "\t     to evfile (see decode_events)\n"
+             "\tevfile: file of the event log (events.sev)\n"
+             "\tfilter: comma-separated list of all, faults (no\n"
+             "\t     references, only page faults) and T0-T1\n"
+             "\t     (only references T0 to T1, from 0; T1 may\n"
+             "\t     be left out)\n"
              "\n",
              VALID_ALGORITHMS, VALID_INIT_ORD);
 
@@ -275,9 +545,58 @@ int parse_command (int argc, char * argv[], sparameters * p)
              "    EXAMPLES:\n"
              "\t%s 16 32 MER RAN 1000\n"
              "\t%s 1 3 HEA DES 4 D\n"
+             "\t%s 16 32 MER RAN 100000 E mer.sev faults,5000-9999\n"
              "\n",
-             argv[0], argv[0]);
+             argv[0], argv[0], argv[0]);
 
     return -1;
 }
 
+static int parse_range (const char * s, int n, sparameters * p)
+{
+    char * end;
+
+    if (!isdigit((unsigned char)s[0]))
+        return -1;
+
+    p->t0 = strtoull (s, &end, 10);
+
+    if (*end!='-')
+        return -1;
+
+    if (++end == s+n)   // No T1
+        return 0;
+
+    if (!isdigit((unsigned char)*end))
+        return -1;
+
+    p->t1 = strtoull (end, &end, 10);
+
+    return end==s+n && p->t1>=p->t0 ? 0 : -1;
+}
+
+int parse_filter (const char * str, sparameters * p)
+{
+    const char * s;
+    int n;
+
+    p->t0 = 0;
+    p->t1 = ~0ULL;
+    p->faultsonly = 0;
+
+    for (s=str; *s; s+=n+(s[n]==','))
+    {
+        for (n=0; s[n] && s[n]!=','; n++)
+            ;
+
+        if (n==3 && !strncmp(s,"all",3))
+            ;
+        else if (n==6 && !strncmp(s,"faults",6))
+            p->faultsonly = 1;
+        else if (parse_range(s,n,p)<0)
+            return -1;
+    }
+
+    return 0;
+}
+
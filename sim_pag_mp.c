@@ -0,0 +1,493 @@
+/*
+    sim_pag_mp.c
+*/
+
+// Multiprogrammed simulation: several traces (processes) run
+// interleaved, a quantum of references each in turn, on the
+// same physical memory. With global replacement all of them
+// share one system: their page tables are laid one after the
+// other in its page table (process k starts at page base[k]),
+// so any policy can take a frame from any process. With local
+// replacement every process gets a fixed part of the frames,
+// with a system of its own. Either way, the policies are the
+// same ones as for a single process.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "sim_paging.h"
+#include "tracegen.h"
+
+#define MAX_PROCS 16
+
+// Structure holding data of the parameters passed through
+// the command line (policy, traces to be used etc.)
+
+typedef struct
+{
+    int pagsz, numframes;
+    const spolicy * policy;
+    char local;                 // 1 = local replacement
+    int quantum;                // References in each turn
+    int numprocs;
+    const char * algorithm[MAX_PROCS];     // Of every process
+    const char * initialstate[MAX_PROCS];
+    int numelem[MAX_PROCS];
+    char spec[MAX_PROCS][8];    // Room for them (ALG and INIT)
+}
+sparameters;
+
+// Structure that holds the state of a process
+
+typedef struct
+{
+    sreferences R;         // Its trace
+    size_t next;           // Next reference to be simulated
+    ssystem * S;           // System where it runs
+    unsigned base;         // Its first address in S
+    int numpags;
+    char name[100];
+
+    // Results of the process alone
+    unsigned long long numrefs;
+    unsigned long long numpagefaults;
+    unsigned long long numpgwriteback;  // Caused by its faults
+    unsigned long long numillegalrefs;
+}
+sprocess;
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char*[], sparameters*);
+
+// Functions that build the processes and the systems
+
+int load_processes (const sparameters *, sprocess * Pr);
+int create_systems (const sparameters *, sprocess * Pr,
+                    ssystem ** pS, int * pnumsys);
+void free_systems (ssystem * S, int numsys);
+
+// Functions that run the processes and show the results
+
+void run_processes (sprocess * Pr, int numprocs, int quantum);
+void print_summary (const sparameters *, sprocess * Pr);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    sprocess Pr[MAX_PROCS];     // Processes
+    ssystem * S;        // Simulated systems (1, or 1 per process)
+    int numsys;
+    int ok, k;
+
+    S = NULL;
+    numsys = 0;
+    memset (Pr, 0, sizeof(Pr));
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %i %i %s %s %i",
+            argv[0], P.pagsz, P.numframes, argv[3],
+            P.local ? "local" : "global", P.quantum);
+
+    for (k=0; k<P.numprocs; k++)
+        printf (" %s", argv[6+k]);
+
+    printf ("\n");
+
+    // The traces are loaded first, so that their references
+    // can be taken in any order
+    ok = load_processes (&P, Pr);
+
+    if (ok && create_systems(&P,Pr,&S,&numsys)<0)
+    {
+        fprintf (stderr,
+                 "ERROR: not enough "
+                        "dynamic memory\n");
+        ok = 0;
+    }
+
+    if (ok)
+    {
+        run_processes (Pr, P.numprocs, P.quantum);
+        print_summary (&P, Pr);
+    }
+
+    for (k=0; k<P.numprocs; k++)
+        free_references (&Pr[k].R);
+
+    free_systems (S, numsys);
+
+    return ok ? 0 : -1;
+}
+
+// Functions that build the processes and the systems
+
+int load_processes (const sparameters * pP, sprocess * Pr)
+{
+    ssource T;
+    int k, ok;
+
+    for (k=0, ok=1; ok && k<pP->numprocs; k++)
+    {
+        ok = source_open (&T, pP->algorithm[k], pP->initialstate[k],
+                          pP->numelem[k]);
+
+        printf ("# Trace of P%d:  %s\n", k, T.name);
+        strcpy (Pr[k].name, T.name);
+
+        if (ok)
+        {
+            ok = load_references (&Pr[k].R, &T);
+
+            if (ok<0)
+                fprintf (stderr,
+                         "ERROR: not enough "
+                                "dynamic memory\n");
+
+            ok = ok==1;
+            Pr[k].numpags = (Pr[k].R.totalsz+pP->pagsz-1) / pP->pagsz;
+        }
+
+        source_close (&T);
+    }
+
+    return ok;
+}
+
+static int create_system (ssystem * S, const sparameters * pP,
+                          int numpags, int numframes)
+{
+    S->pagsz = pP->pagsz;
+    S->numpags = numpags;
+    S->numframes = numframes;
+    S->policy = pP->policy;
+    S->frt = (sframe*) malloc (numframes*sizeof(sframe));
+
+    if (alloc_page_table(S)<0 || !S->frt)
+        return -1;
+
+    S->policy->init_tables (S);
+
+    return 0;
+}
+
+int create_systems (const sparameters * pP, sprocess * Pr,
+                    ssystem ** pS, int * pnumsys)
+{
+    ssystem * S;
+    unsigned long long base;
+    int k;
+
+    *pnumsys = pP->local ? pP->numprocs : 1;
+    *pS = S = (ssystem*) calloc (*pnumsys, sizeof(ssystem));
+
+    if (!S)
+        return -1;
+
+    if (pP->local)
+    {
+        // numframes/numprocs frames each (one more for the
+        // first numframes%numprocs processes)
+        for (k=0; k<pP->numprocs; k++)
+        {
+            Pr[k].S = &S[k];
+            Pr[k].base = 0;
+
+            if (create_system(&S[k],pP,Pr[k].numpags,
+                              pP->numframes/pP->numprocs +
+                              (k < pP->numframes%pP->numprocs))<0)
+                return -1;
+        }
+
+        return 0;
+    }
+
+    // One page table after another
+    for (k=0, base=0; k<pP->numprocs; k++)
+    {
+        Pr[k].S = S;
+        Pr[k].base = base;
+        base += (unsigned long long) Pr[k].numpags * pP->pagsz;
+
+        if (base > UINT_MAX)
+        {
+            fprintf (stderr, "ERROR: the traces are too big "
+                             "for global replacement\n");
+            return -1;
+        }
+    }
+
+    return create_system (S, pP, base/pP->pagsz, pP->numframes);
+}
+
+void free_systems (ssystem * S, int numsys)
+{
+    int s;
+
+    for (s=0; s<numsys; s++)
+    {
+        free_page_table (&S[s]);
+        free (S[s].frt);
+    }
+
+    free (S);
+}
+
+// Functions that run the processes: every turn, the next
+// quantum references of each process that has not finished
+// yet. What its references add to the counters of its system
+// belongs to the process.
+
+void run_processes (sprocess * Pr, int numprocs, int quantum)
+{
+    sprocess * p;
+    ssystem * S;
+    unsigned long long faults, writebacks;
+    unsigned ref, size;
+    size_t end;
+    int k, running;
+
+    do
+        for (k=0, running=0; k<numprocs; k++)
+        {
+            p = &Pr[k];
+            S = p->S;
+            size = p->numpags * S->pagsz;
+
+            if ((end = p->next+quantum) > p->R.numrefs)
+                end = p->R.numrefs;
+
+            faults = S->numpagefaults;
+            writebacks = S->numpgwriteback;
+
+            for (; p->next<end; p->next++)
+            {
+                ref = p->R.refs[p->next];
+
+                // Out of its own pages (not of those of others)
+                if (TRACE_REF_POS(ref) >= size)
+                    p->numillegalrefs ++;
+                else
+                    sim_mmu (S, p->base+TRACE_REF_POS(ref),
+                             TRACE_REF_OP(ref));
+            }
+
+            p->numpagefaults += S->numpagefaults-faults;
+            p->numpgwriteback += S->numpgwriteback-writebacks;
+
+            running |= p->next < p->R.numrefs;
+        }
+    while (running);
+
+    for (k=0; k<numprocs; k++)
+        Pr[k].numrefs = Pr[k].R.numrefs;
+}
+
+// Function that shows the results: with global replacement,
+// the frames of a process are those it holds at the end
+
+static int process_frames (const sprocess * p)
+{
+    const ssystem * S = p->S;
+    int f, first, n;
+
+    first = p->base / S->pagsz;
+
+    for (f=0, n=0; f<S->numframes; f++)
+        if (S->frt[f].page >= first &&
+            S->frt[f].page < first+p->numpags)
+            n ++;
+
+    return n;
+}
+
+void print_summary (const sparameters * pP, sprocess * Pr)
+{
+    unsigned long long refs, faults, writebacks;
+    int k;
+
+    printf ("\n# %s replacement, %s, %d frames\n",
+            pP->local ? "Local" : "Global", pP->policy->name,
+            pP->numframes);
+
+    printf ("\n#%8s %10s %10s %12s %12s %12s  %s\n",
+            "Process", "Pages", "Frames", "References",
+            "Page faults", "Dumps", "Trace");
+
+    for (k=0, refs=0, faults=0, writebacks=0; k<pP->numprocs; k++)
+    {
+        printf ("%9d %10d %10d %12llu %12llu %12llu  %s\n",
+                k, Pr[k].numpags,
+                pP->local ? Pr[k].S->numframes : process_frames(&Pr[k]),
+                Pr[k].numrefs, Pr[k].numpagefaults,
+                Pr[k].numpgwriteback, Pr[k].name);
+
+        refs += Pr[k].numrefs;
+        faults += Pr[k].numpagefaults;
+        writebacks += Pr[k].numpgwriteback;
+
+        if (Pr[k].numillegalrefs)
+            printf ("\nWARNING: %llu REFERENCES OF P%d OUT OF RANGE\n\n",
+                    Pr[k].numillegalrefs, k);
+    }
+
+    printf ("%9s %10s %10d %12llu %12llu %12llu\n",
+            "Total", "", pP->numframes, refs, faults, writebacks);
+
+    printf ("\nPAGE FAULTS: --->> %llu <<---\n\n", faults);
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+static int parse_trace (const char * str, sparameters * p, int k)
+{
+    char * s = p->spec[k];
+
+    p->algorithm[k] = str;     // A file, or -
+    p->initialstate[k] = "RAN";
+    p->numelem[k] = 1000;
+
+    if (!strcmp(str,"-") || source_is_file(str))
+        return 0;
+
+    // ALG:INIT:N
+    if (strlen(str)<9 || str[3]!=':' || str[7]!=':' ||
+        sscanf(str+8,"%d",&p->numelem[k])!=1 || p->numelem[k]<2)
+        return -1;
+
+    memcpy (s, str, 3);
+    memcpy (s+4, str+4, 3);
+    s[3] = s[7] = '\0';
+    p->algorithm[k] = s;
+    p->initialstate[k] = s+4;
+
+    return strchr(s,'/') || !strstr(VALID_ALGORITHMS,s) ||
+           strchr(s+4,'/') || !strstr(VALID_INIT_ORD,s+4) ? -1 : 0;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, k, stdins;
+
+    // Default parameters
+    p->pagsz = 16;
+    p->numframes = 32;
+    p->policy = &policy_lru;
+    p->local = 0;
+    p->quantum = 100;
+    p->numprocs = 0;
+
+    if (argc<7 || argc>6+MAX_PROCS)
+    {
+        fprintf (stderr,
+                 argc<7 ? "\n    ERROR: too few parameters"
+                        : "\n    ERROR: too many processes");
+        ok = 0;
+    }
+    else
+    {
+        ok = 1;
+
+        if (sscanf(argv[1],"%d",&p->pagsz)!=1 || p->pagsz<1)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size");
+            ok = 0;
+        }
+
+        if (sscanf(argv[2],"%d",&p->numframes)!=1 ||
+            p->numframes<argc-6)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of frames "
+                                  "(at least one per process)");
+            ok = 0;
+        }
+
+        if (!(p->policy = find_policy(argv[3],strlen(argv[3]))))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong policy");
+            ok = 0;
+        }
+
+        if (strcmp(argv[4],"global") && strcmp(argv[4],"local"))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong scope");
+            ok = 0;
+        }
+
+        p->local = !strcmp(argv[4],"local");
+
+        if (sscanf(argv[5],"%d",&p->quantum)!=1 || p->quantum<1)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong quantum");
+            ok = 0;
+        }
+
+        for (k=6, stdins=0; k<argc; k++, p->numprocs++)
+        {
+            if (parse_trace(argv[k],p,p->numprocs)<0)
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong trace %s", argv[k]);
+                ok = 0;
+            }
+
+            stdins += !strcmp(argv[k],"-");
+        }
+
+        if (stdins>1)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: only one trace can come from "
+                                  "the standard input");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n\n    USAGE:\n\t%s pagesize numframes policy "
+                          "scope quantum trace...\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tpagesize: # of elements that fit in a page\n"
+             "\tnumframes: # of page frames (physical mem.)\n"
+             "\tpolicy: replacement policy (%s)\n"
+             "\tscope: global (any process can take the frames of\n"
+             "\t     the others) or local (the frames are split\n"
+             "\t     evenly among the processes) replacement\n"
+             "\tquantum: # of references of each process in\n"
+             "\t     every turn (1 = round-robin)\n"
+             "\ttrace: the trace of each process (up to %d):\n"
+             "\t     ALG:INIT:N to sort N elements with the\n"
+             "\t     algorithm ALG (%s) from\n"
+             "\t     the initial state INIT (%s),\n"
+             "\t     or - to read it from the standard input,\n"
+             "\t     or the name of a file (with a / or a .)\n"
+             "\n",
+             VALID_POLICIES, MAX_PROCS, VALID_ALGORITHMS,
+             VALID_INIT_ORD);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 16 32 lru global 100 MER:RAN:1000 HEA:RAN:1000\n"
+             "\t%s 16 32 lru local 1 MER:RAN:1000 HEA:RAN:1000\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
@@ -0,0 +1,350 @@
+/*
+    sim_pag_multi.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_paging.h"
+#include "tracegen.h"
+
+#define MAX_FRAME_COUNTS 64
+#define MAX_POLICIES 16
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagsz;
+    int numframes[MAX_FRAME_COUNTS];  // Frame counts to simulate
+    int numcounts;                    // # of frame counts
+    const spolicy * policy[MAX_POLICIES];  // Policies to simulate
+    int numpolicies;                  // # of policies
+    const char * algorithm, * initialstate;
+    int numelem;
+}
+sparameters;
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char*[], sparameters*);
+
+// Functions that build and show the simulated systems
+
+int create_systems (const sparameters *, unsigned numpags,
+                    ssystem ** pS, int * pnumsys);
+void free_systems (ssystem * S, int numsys);
+void print_summary (ssystem * S, int numsys);
+
+// Function that receives the operations of the trace, and
+// the structure that it receives as its first parameter
+
+function_sink simulate_access;
+
+typedef struct
+{
+    ssystem * S;
+    int numsys;
+}
+ssystems;
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    ssource T;          // Where the trace comes from
+    int ok;             // Flag
+    unsigned numpags;   // Total number of pages
+    ssystem * S;        // Simulated systems (policy x frames)
+    int numsys;         // Number of simulated systems
+    ssystems A;         // What the sink of the trace needs
+
+    S = NULL;
+    numsys = 0;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    printf ("# Parameters:  %s %i %i policies %i frame counts "
+            "%s %s %i\n",
+            argv[0], P.pagsz, P.numpolicies, P.numcounts,
+            P.algorithm, P.initialstate, P.numelem);
+
+    // The trace is generated only once, and every reference
+    // is fed to all the simulated systems
+    ok = source_open (&T, P.algorithm, P.initialstate, P.numelem);
+
+    printf ("# Trace:  %s\n", T.name);
+
+    if (ok)
+    {
+        // Calculate total number of pages
+        numpags = (T.totalsz+P.pagsz-1) / P.pagsz;
+
+        if (create_systems(&P,numpags,&S,&numsys)<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+    {
+        A.S = S;
+        A.numsys = numsys;
+        ok = source_run (&T, simulate_access, &A);
+    }
+
+    if (ok)
+        print_summary (S, numsys);
+
+    source_close (&T);
+
+    free_systems (S, numsys);
+
+    return ok ? 0 : -1;
+}
+
+// Simulates one access of the trace in every system
+
+void simulate_access (void * p, char op, unsigned pos)
+{
+    ssystems * pA = (ssystems*) p;
+    int s;
+
+    if (op=='C')          // 'C'omparisons do not access memory
+        return;
+
+    for (s=0; s<pA->numsys; s++)
+        sim_mmu (&pA->S[s], pos, op);
+}
+
+// Functions that build and show the simulated systems
+
+int create_systems (const sparameters * pP, unsigned numpags,
+                    ssystem ** pS, int * pnumsys)
+{
+    ssystem * S;
+    int p, c, s;
+
+    *pnumsys = pP->numpolicies * pP->numcounts;
+    *pS = S = (ssystem*) calloc (*pnumsys, sizeof(ssystem));
+
+    if (!S)
+        return -1;
+
+    for (p=0, s=0; p<pP->numpolicies; p++)
+        for (c=0; c<pP->numcounts; c++, s++)
+        {
+            S[s].pagsz = pP->pagsz;
+            S[s].numpags = numpags;
+            S[s].numframes = pP->numframes[c];
+            S[s].policy = pP->policy[p];
+            S[s].frt = (sframe*) malloc (S[s].numframes*sizeof(sframe));
+
+            if (alloc_page_table(&S[s])<0 || !S[s].frt)
+                return -1;
+
+            S[s].policy->init_tables (&S[s]);
+        }
+
+    return 0;
+}
+
+void free_systems (ssystem * S, int numsys)
+{
+    int s;
+
+    for (s=0; s<numsys; s++)
+    {
+        free_page_table (&S[s]);
+        free (S[s].frt);
+    }
+
+    free (S);
+}
+
+// The average frames are those occupied at every reference
+// (the same as Frames for most policies, once they are full,
+// but not for those that give frames back, like WS and PFF)
+
+void print_summary (ssystem * S, int numsys)
+{
+    unsigned long long refs;
+    int s;
+
+    printf ("\n#%17s %10s %10s %12s %12s %12s\n",
+            "Policy", "Frames", "Avg frames", "Page faults",
+            "Dumps", "Illegal refs");
+
+    for (s=0; s<numsys; s++)
+    {
+        refs = S[s].numrefsread + S[s].numrefswrite;
+
+        printf ("%18s %10d %10.2f %12llu %12llu %12llu\n",
+                S[s].policy->name, S[s].numframes,
+                refs ? (double) S[s].framerefs/refs : 0.0,
+                S[s].numpagefaults, S[s].numpgwriteback,
+                S[s].numillegalrefs);
+    }
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+static int parse_frame_counts (const char * str, sparameters * p)
+{
+    const char * s;
+    int n;
+
+    for (s=str, p->numcounts=0; *s; s+=n+(s[n]==','))
+    {
+        for (n=0; s[n] && s[n]!=','; n++)
+            ;
+
+        if (p->numcounts==MAX_FRAME_COUNTS ||
+            sscanf(s,"%d",&p->numframes[p->numcounts])!=1 ||
+            p->numframes[p->numcounts]<1)
+            return -1;
+
+        p->numcounts ++;
+    }
+
+    return p->numcounts ? 0 : -1;
+}
+
+static int parse_policies (const char * str, sparameters * p)
+{
+    const char * s;
+    int n;
+
+    for (s=str, p->numpolicies=0; *s; s+=n+(s[n]==','))
+    {
+        for (n=0; s[n] && s[n]!=','; n++)
+            ;
+
+        if (p->numpolicies==MAX_POLICIES ||
+            !(p->policy[p->numpolicies]=find_policy(s,n)))
+            return -1;
+
+        p->numpolicies ++;
+    }
+
+    return p->numpolicies ? 0 : -1;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok;
+
+    // Default parameters
+    p->pagsz = 16;
+    p->algorithm = "MER";
+    p->initialstate = "RAN";
+    p->numelem = 1000;
+    parse_frame_counts ("8,16,32,64", p);
+    parse_policies (VALID_POLICIES, p);
+
+    if (argc>7)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        ok = 1;
+
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
+                       p->pagsz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size");
+            ok = 0;
+        }
+
+        if (argc>2 && parse_frame_counts(argv[2],p)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong list of frame counts");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->algorithm = argv[3];
+
+        if (strcmp(p->algorithm,"-") && !source_is_file(p->algorithm) &&
+            (strlen(p->algorithm)!=3 ||
+             strchr(p->algorithm,'/') ||
+             !strstr(VALID_ALGORITHMS,p->algorithm)))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>4)
+            p->initialstate = argv[4];
+
+        if (strlen(p->initialstate)!=3 ||
+            strchr(p->initialstate,'/') ||
+            !strstr(VALID_INIT_ORD,p->initialstate))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial state");
+            ok = 0;
+        }
+
+        if (argc>5 && (sscanf(argv[5],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements");
+            ok = 0;
+        }
+
+        if (argc>6 && parse_policies(argv[6],p)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong list of policies");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n\n    USAGE:\n\t%s pagesize frames alg "
+                          "initord numelem policies\n\n", argv[0]);
+
+    fprintf (stderr,
+             "\tpagesize: # of elements that fit in a page\n"
+             "\tframes: comma-separated list of numbers of "
+                       "page frames\n"
+             "\talg: sorting algorithm (%s),\n"
+             "\t     or - to read a trace from the standard input,\n"
+             "\t     or the name of a file with a trace (with a / or a .)\n"
+             "\tinitord: initial state of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\tpolicies: comma-separated list of replacement "
+                         "policies (%s)\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD, VALID_POLICIES);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 16 8,16,32,64 MER RAN 1000\n"
+             "\t%s 4 3,4,5 HEA DES 100 fifo,fifo2ch\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
@@ -0,0 +1,277 @@
+/*
+    sim_pag_opt.c
+*/
+
+// Optimal replacement (Belady's MIN): the victim is the page
+// whose next reference is the farthest in the future (or that
+// is never referenced again). It needs the whole trace in
+// advance: prepare_trace computes, in one backward pass, the
+// next use of the page of every reference, and the frames are
+// kept in a max-heap by the next use of their pages, so each
+// victim is at the top and every reference costs O(log
+// numframes).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "./sim_paging.h"
+#include "./trace.h"
+
+#define NEVER SIZE_MAX  // Next use of a page not referenced again
+
+// Functions that handle the heap of frames (the key of frame f
+// is S->frt[f].nextuse, and S->frt[f].heappos is its position)
+
+static void heap_swap(ssystem* S, int i, int j) {
+  int fi = S->heap[i], fj = S->heap[j];
+
+  S->heap[i] = fj;
+  S->heap[j] = fi;
+  S->frt[fj].heappos = i;
+  S->frt[fi].heappos = j;
+}
+
+static void heap_sift_up(ssystem* S, int i) {
+  while (i > 0 &&
+         S->frt[S->heap[(i - 1) / 2]].nextuse < S->frt[S->heap[i]].nextuse) {
+    heap_swap(S, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void heap_sift_down(ssystem* S, int i) {
+  int c;
+
+  while ((c = 2 * i + 1) < S->heapsize) {
+    if (c + 1 < S->heapsize &&
+        S->frt[S->heap[c + 1]].nextuse > S->frt[S->heap[c]].nextuse)
+      c++;
+
+    if (S->frt[S->heap[c]].nextuse <= S->frt[S->heap[i]].nextuse)
+      break;
+
+    heap_swap(S, i, c);
+    i = c;
+  }
+}
+
+// Function that initialises the tables
+
+static void init_tables(ssystem* S) {
+  int i;
+
+  // Reset pages
+  clear_page_table(S);
+
+  // Split of addresses for this page size
+  init_translation(S);
+
+  // Circular list of free frames
+  for (i = 0; i < S->numframes - 1; i++) {
+    S->frt[i].page = -1;
+    S->frt[i].next = i + 1;
+  }
+
+  S->frt[i].page = -1;  // Now i == numframes-1
+  S->frt[i].next = 0;   // Close circular list
+  S->listfree = i;      // Point to the last one
+
+  // Empty heap, and no reference simulated yet
+  S->heapsize = 0;
+  S->now = 0;
+}
+
+// Function that reads the future: nextuse[t] is the index of
+// the next reference to the page of reference t (counting only
+// those in range, which are the ones that reach reference_page)
+
+static int prepare_trace(ssystem* S, const unsigned* refs, size_t numrefs) {
+  size_t* last;
+  size_t u, n;
+  unsigned page;
+
+  for (u = 0, n = 0; u < numrefs; u++)
+    if (TRACE_REF_OP(refs[u]) != 'C' &&
+        address_page(S, TRACE_REF_POS(refs[u])) < S->numpags)
+      n++;
+
+  S->nextuse = (size_t*)malloc((n ? n : 1) * sizeof(size_t));
+  S->heap = (int*)malloc(S->numframes * sizeof(int));
+  last = (size_t*)malloc(S->numpags * sizeof(size_t));
+
+  if (!S->nextuse || !S->heap || !last) {
+    free(last);
+    return -1;
+  }
+
+  for (page = 0; page < S->numpags; page++)
+    last[page] = NEVER;
+
+  for (u = numrefs; u-- > 0;) {
+    page = address_page(S, TRACE_REF_POS(refs[u]));
+
+    if (TRACE_REF_OP(refs[u]) != 'C' && page < S->numpags) {
+      S->nextuse[--n] = last[page];
+      last[page] = n;
+    }
+  }
+
+  free(last);
+
+  return 0;
+}
+
+// Functions that simulate the hardware of the MMU
+
+static void reference_page(ssystem* S, int page, char op) {
+  int frame = PAGE_FRAME(S, page);
+
+  if (op == 'R') {              // If it's a read,
+    S->numrefsread++;           // count it
+  } else if (op == 'W') {       // If it's a write,
+    PAGE_MODIFIED(S, page) = 1; // count it and mark the
+    S->numrefswrite++;          // page 'modified'
+  }
+
+  // Its next use can only be later than this one
+  S->frt[frame].nextuse = S->nextuse[S->now++];
+  heap_sift_up(S, S->frt[frame].heappos);
+}
+
+static void reference_run(ssystem* S, int page,
+                          unsigned long long reads,
+                          unsigned long long writes) {
+  int frame = PAGE_FRAME(S, page);
+
+  S->numrefsread += reads;
+  S->numrefswrite += writes;
+
+  if (writes)
+    PAGE_MODIFIED(S, page) = 1;
+
+  S->now += reads + writes;
+  S->frt[frame].nextuse = S->nextuse[S->now - 1];
+  heap_sift_up(S, S->frt[frame].heappos);
+}
+
+// Functions that simulate the operating system
+
+static int choose_page_to_be_replaced(ssystem* S) {
+  int frame = S->heap[0], victim = S->frt[frame].page;
+
+  if (S->detailed) {
+    if (S->frt[frame].nextuse == NEVER)
+      printf(
+          "@ Choosing (at OPT) P%d of F%d to be "
+          "replaced (not used again)\n",
+          victim, frame);
+    else
+      printf(
+          "@ Choosing (at OPT) P%d of F%d to be "
+          "replaced (next use: reference %zu)\n",
+          victim, frame, S->frt[frame].nextuse);
+  }
+
+  return victim;
+}
+
+static void replace_page(ssystem* S, int victim, int newpage) {
+  int frame = PAGE_FRAME(S, victim);
+
+  if (PAGE_MODIFIED(S, victim)) {
+    if (S->detailed)
+      printf(
+          "@ Writing modified P%d back (to disc) to "
+          "replace it\n",
+          victim);
+
+    S->numpgwriteback++;
+  }
+
+  if (S->detailed)
+    printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
+
+  PAGE_PRESENT(S, victim) = 0;
+
+  PAGE_PRESENT(S, newpage) = 1;
+  PAGE_FRAME(S, newpage) = frame;
+  PAGE_MODIFIED(S, newpage) = 0;
+
+  S->frt[frame].page = newpage;
+
+  // It is referenced now (reference_page will put its next use)
+  S->frt[frame].nextuse = S->now;
+  heap_sift_down(S, S->frt[frame].heappos);
+}
+
+static void occupy_free_frame(ssystem* S, int frame, int page) {
+  if (S->detailed)
+    printf("@ Storing P%d in F%d\n", page, frame);
+
+  PAGE_PRESENT(S, page) = 1;
+  PAGE_FRAME(S, page) = frame;
+  PAGE_MODIFIED(S, page) = 0;
+
+  S->frt[frame].page = page;
+
+  // Put it in the heap
+  S->frt[frame].nextuse = S->now;
+  S->frt[frame].heappos = S->heapsize;
+  S->heap[S->heapsize++] = frame;
+  heap_sift_up(S, S->frt[frame].heappos);
+}
+
+// Functions that show results
+
+static void print_page_table(ssystem* S) {
+  int p;
+
+  printf("%10s %10s %10s %10s\n", "PAGE", "Present", "Frame", "Modified");
+
+  for (p = 0; p < S->numpags; p++)
+    if (PAGE_PRESENT(S, p))
+      printf("%8d   %6d     %8d   %6d\n", p, PAGE_PRESENT(S, p),
+             PAGE_FRAME(S, p), PAGE_MODIFIED(S, p));
+    else
+      printf("%8d   %6d     %8s   %6s\n", p, PAGE_PRESENT(S, p), "-", "-");
+}
+
+static void print_frames_table(ssystem* S) {
+  int p, f;
+
+  printf("%10s %10s %10s   %s\n", "FRAME", "Page", "Modified", "Next use");
+
+  for (f = 0; f < S->numframes; f++) {
+    p = S->frt[f].page;
+
+    if (p == -1)
+      printf("%8d   %8s     %6s     %s\n", f, "-", "-", "-");
+    else if (S->frt[f].nextuse == NEVER)
+      printf("%8d   %8d     %6d     %s\n", f, p, PAGE_MODIFIED(S, p), "never");
+    else
+      printf("%8d   %8d     %6d     %zu\n", f, p, PAGE_MODIFIED(S, p),
+             S->frt[f].nextuse);
+  }
+}
+
+static void print_replacement_report(ssystem* S) {
+  printf("OPT replacement (%zu references simulated)\n", S->now);
+}
+
+// Replacement policy
+
+const spolicy policy_opt = {
+  "OPT",
+  init_tables,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report,
+  prepare_trace
+};
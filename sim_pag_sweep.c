@@ -0,0 +1,566 @@
+/*
+    sim_pag_sweep.c
+*/
+
+// Simulates a grid of systems (policy x page size x number
+// of frames) over the same trace, and writes the results of
+// every cell as CSV or JSON. The trace is generated only once
+// and kept in memory, and the cells are simulated in parallel
+// by a pool of threads that share it (each cell has its own
+// ssystem, and the policies keep no global state).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sim_paging.h"
+#include "tracegen.h"
+
+#define MAX_VALUES 256
+#define MAX_POLICIES 16
+#define MAX_WORKERS 256
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagsz[MAX_VALUES];            // Page sizes to simulate
+    int numpagsz;                     // # of page sizes
+    int numframes[MAX_VALUES];        // Frame counts to simulate
+    int numcounts;                    // # of frame counts
+    const spolicy * policy[MAX_POLICIES];  // Policies to simulate
+    int numpolicies;                  // # of policies
+    const char * algorithm, * initialstate;
+    int numelem;
+    char json;                        // 1 = JSON, 0 = CSV
+    int numworkers;                   // # of threads
+    const char * tlb;                 // TLB of the cells (or NULL)
+}
+sparameters;
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char*[], sparameters*);
+
+// Structure that holds the results of one cell of the grid
+
+typedef struct
+{
+    const spolicy * policy;
+    int pagsz, numframes, numpags;
+    unsigned long long numpagefaults, numpgwriteback, numillegalrefs;
+    unsigned long long tlbhits, tlbmisses;
+    int ok;                           // 0 = not enough memory
+}
+scell;
+
+// Structure shared by all the threads: each one takes the
+// next cell to be simulated from 'next'
+
+typedef struct
+{
+    const sreferences * pR;           // The trace
+    const char * tlb;                 // See TLB_ENV (or NULL)
+    scell * cells;
+    int numcells;
+    int next;
+}
+ssweep;
+
+// Functions that simulate the cells and show the results
+
+int create_cells (const sparameters *, unsigned totalsz,
+                  ssweep *);
+void simulate_cell (const sreferences *, const char * tlb, scell *);
+void * run_worker (void *);
+int run_workers (ssweep *, int numworkers);
+void print_cells (const sparameters *, const ssource *,
+                  const ssweep *);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    ssource T;          // Where the trace comes from
+    sreferences R;      // The trace, in memory
+    ssweep W;           // The grid
+    int ok;             // Flag
+
+    W.cells = NULL;
+    R.refs = NULL;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    ok = source_open (&T, P.algorithm, P.initialstate, P.numelem);
+
+    // Load the trace only once
+    if (ok)
+    {
+        ok = load_references (&R, &T);
+
+        if (ok<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+    }
+
+    if (ok && create_cells(&P,R.totalsz,&W)<0)
+    {
+        fprintf (stderr,
+                 "ERROR: not enough "
+                        "dynamic memory\n");
+        ok = 0;
+    }
+
+    if (ok)
+    {
+        W.pR = &R;
+        W.tlb = P.tlb;
+        ok = run_workers (&W, P.numworkers) == 0;
+    }
+
+    if (ok)
+        print_cells (&P, &T, &W);
+
+    source_close (&T);
+
+    free (W.cells);
+    free_references (&R);
+
+    return ok ? 0 : -1;
+}
+
+// Functions that simulate the cells
+
+int create_cells (const sparameters * pP, unsigned totalsz,
+                  ssweep * pW)
+{
+    int p, g, c, n;
+
+    pW->numcells = pP->numpolicies * pP->numpagsz * pP->numcounts;
+    pW->next = 0;
+    pW->cells = (scell*) calloc (pW->numcells, sizeof(scell));
+
+    if (!pW->cells)
+        return -1;
+
+    for (p=0, n=0; p<pP->numpolicies; p++)
+        for (g=0; g<pP->numpagsz; g++)
+            for (c=0; c<pP->numcounts; c++, n++)
+            {
+                pW->cells[n].policy = pP->policy[p];
+                pW->cells[n].pagsz = pP->pagsz[g];
+                pW->cells[n].numframes = pP->numframes[c];
+                pW->cells[n].numpags = (totalsz+pP->pagsz[g]-1) /
+                                       pP->pagsz[g];
+            }
+
+    return 0;
+}
+
+void simulate_cell (const sreferences * pR, const char * tlb,
+                    scell * pC)
+{
+    ssystem S;
+    srun R;
+    size_t u;
+    unsigned r;
+
+    memset (&S, 0, sizeof(S));
+
+    S.policy = pC->policy;
+    S.pagsz = pC->pagsz;
+    S.numpags = pC->numpags;
+    S.numframes = pC->numframes;
+    S.frt = (sframe*) malloc (S.numframes*sizeof(sframe));
+
+    pC->ok = alloc_page_table(&S)==0 && S.frt &&
+             (!tlb || tlb_create(&S,tlb)==0);
+
+    if (pC->ok)
+    {
+        S.policy->init_tables (&S);
+        run_start (&R);
+
+        // References folded into runs (exact, and faster)
+        for (u=0; u<pR->numrefs; u++)
+        {
+            r = pR->refs[u];
+            run_reference (&S, &R, TRACE_REF_POS(r), TRACE_REF_OP(r));
+        }
+
+        run_flush (&S, &R);
+
+        pC->numpagefaults = S.numpagefaults;
+        pC->numpgwriteback = S.numpgwriteback;
+        pC->numillegalrefs = S.numillegalrefs;
+
+        if (S.tlb)
+        {
+            pC->tlbhits = S.tlb->hits;
+            pC->tlbmisses = S.tlb->misses;
+        }
+    }
+
+    free_page_table (&S);
+    free (S.frt);
+}
+
+void * run_worker (void * p)
+{
+    ssweep * pW = (ssweep*) p;
+    int n;
+
+    while ((n=__sync_fetch_and_add(&pW->next,1)) < pW->numcells)
+        simulate_cell (pW->pR, pW->tlb, &pW->cells[n]);
+
+    return NULL;
+}
+
+int run_workers (ssweep * pW, int numworkers)
+{
+    pthread_t th[MAX_WORKERS];
+    int w, n, ok;
+
+    if (numworkers>pW->numcells)
+        numworkers = pW->numcells;
+
+    // The calling thread is one of the workers
+    for (w=0; w<numworkers-1; w++)
+        if (pthread_create(&th[w],NULL,run_worker,pW))
+        {
+            fprintf (stderr, "ERROR: cannot create thread\n");
+            break;
+        }
+
+    // (alone if no other could be created)
+    run_worker (pW);
+
+    for (n=0; n<w; n++)
+        pthread_join (th[n], NULL);
+
+    for (n=0, ok=1; n<pW->numcells; n++)
+        if (!pW->cells[n].ok)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+            break;
+        }
+
+    return ok ? 0 : -1;
+}
+
+// Function that shows the results
+
+// Writes str as a JSON string (the trace can be a file name)
+
+static void print_json_string (const char * str)
+{
+    putchar ('"');
+
+    for (; *str; str++)
+        if (*str=='"' || *str=='\\')
+            printf ("\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            printf ("\\u%04x", (unsigned char)*str);
+        else
+            putchar (*str);
+
+    putchar ('"');
+}
+
+void print_cells (const sparameters * pP, const ssource * pT,
+                  const ssweep * pW)
+{
+    const scell * C;
+    int n;
+
+    if (pP->json)
+    {
+        printf ("{\n  \"trace\": ");
+        print_json_string (pT->name);
+        printf (",\n  \"cells\": [\n");
+    }
+    else
+    {
+        printf ("# Trace:  %s\n", pT->name);
+        printf ("policy,pagsz,frames,pages,faults,"
+                "writebacks,illegal%s\n",
+                pP->tlb ? ",tlbhits,tlbmisses" : "");
+    }
+
+    for (n=0; n<pW->numcells; n++)
+    {
+        C = &pW->cells[n];
+
+        if (pP->json)
+            printf ("    { \"policy\": \"%s\", \"pagsz\": %d, "
+                    "\"frames\": %d, \"pages\": %d, "
+                    "\"faults\": %llu, \"writebacks\": %llu, "
+                    "\"illegal\": %llu",
+                    policy_key(C->policy), C->pagsz, C->numframes,
+                    C->numpags, C->numpagefaults,
+                    C->numpgwriteback, C->numillegalrefs);
+        else
+            printf ("%s,%d,%d,%d,%llu,%llu,%llu",
+                    policy_key(C->policy), C->pagsz, C->numframes,
+                    C->numpags, C->numpagefaults,
+                    C->numpgwriteback, C->numillegalrefs);
+
+        // Only with a TLB, so that the columns do not change
+        if (pP->tlb)
+            printf (pP->json ? ", \"tlbhits\": %llu, "
+                               "\"tlbmisses\": %llu" : ",%llu,%llu",
+                    C->tlbhits, C->tlbmisses);
+
+        if (pP->json)
+            printf (" }%s\n", n<pW->numcells-1 ? "," : "");
+        else
+            printf ("\n");
+    }
+
+    if (pP->json)
+        printf ("  ]\n}\n");
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+// Lists of values: comma-separated numbers or ranges lo:hi
+// (step 1), lo:hi:step or lo:hi:xfactor (geometric)
+
+static int parse_range (const char * str, int * v, int * pnum)
+{
+    const char * s;
+    int n, lo, hi, step, geometric;
+    long long next;           // Does not overflow
+    char x;
+
+    for (s=str, *pnum=0; *s; s+=n+(s[n]==','))
+    {
+        for (n=0; s[n] && s[n]!=','; n++)
+            ;
+
+        step = 1;
+        geometric = 0;
+
+        if (sscanf(s,"%d:%d:%c",&lo,&hi,&x)==3)
+        {
+            geometric = x=='x';
+
+            if (sscanf(s,geometric?"%*d:%*d:x%d":"%*d:%*d:%d",
+                       &step)!=1)
+                return -1;
+        }
+        else if (sscanf(s,"%d:%d",&lo,&hi)!=2)
+        {
+            if (sscanf(s,"%d",&lo)!=1)
+                return -1;
+
+            hi = lo;
+        }
+
+        if (lo<1 || hi<lo || step<1 || (geometric && step<2))
+            return -1;
+
+        for (next=lo; next<=hi; )
+        {
+            if (*pnum==MAX_VALUES)
+                return -1;
+
+            v[(*pnum)++] = next;
+            next = geometric ? next*step : next+step;
+        }
+    }
+
+    return *pnum ? 0 : -1;
+}
+
+static int parse_policies (const char * str, sparameters * p)
+{
+    const char * s;
+    int n;
+
+    for (s=str, p->numpolicies=0; *s; s+=n+(s[n]==','))
+    {
+        for (n=0; s[n] && s[n]!=','; n++)
+            ;
+
+        if (p->numpolicies==MAX_POLICIES ||
+            !(p->policy[p->numpolicies]=find_policy(s,n)))
+            return -1;
+
+        p->numpolicies ++;
+    }
+
+    return p->numpolicies ? 0 : -1;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok;
+    long ncpus;
+    ssystem S;
+
+    // Default parameters
+    parse_range ("4:64:x2", p->pagsz, &p->numpagsz);
+    parse_range ("4:64:x2", p->numframes, &p->numcounts);
+    p->algorithm = "MER";
+    p->initialstate = "RAN";
+    p->numelem = 1000;
+    parse_policies ("lru", p);
+    p->json = 0;
+    ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+    p->numworkers = ncpus<1 ? 1 : ncpus>MAX_WORKERS ?
+                                      MAX_WORKERS : ncpus;
+    p->tlb = getenv (TLB_ENV);
+
+    if (argc>9)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: too many parameters");
+        ok = 0;
+    }
+    else
+    {
+        ok = 1;
+
+        if (argc>1 && parse_range(argv[1],p->pagsz,&p->numpagsz)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page sizes");
+            ok = 0;
+        }
+
+        if (argc>2 &&
+            parse_range(argv[2],p->numframes,&p->numcounts)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong frame counts");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->algorithm = argv[3];
+
+        if (strcmp(p->algorithm,"-") && !source_is_file(p->algorithm) &&
+            (strlen(p->algorithm)!=3 ||
+             strchr(p->algorithm,'/') ||
+             !strstr(VALID_ALGORITHMS,p->algorithm)))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm");
+            ok = 0;
+        }
+
+        if (argc>4)
+            p->initialstate = argv[4];
+
+        if (strlen(p->initialstate)!=3 ||
+            strchr(p->initialstate,'/') ||
+            !strstr(VALID_INIT_ORD,p->initialstate))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial state");
+            ok = 0;
+        }
+
+        if (argc>5 && (sscanf(argv[5],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements");
+            ok = 0;
+        }
+
+        if (argc>6 && parse_policies(argv[6],p)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong list of policies");
+            ok = 0;
+        }
+
+        if (argc>7)
+        {
+            if (!strcmp(argv[7],"CSV"))
+                p->json = 0;
+            else if (!strcmp(argv[7],"JSON"))
+                p->json = 1;
+            else
+            {
+                fprintf (stderr,
+                         "\n    ERROR: wrong output format");
+                ok = 0;
+            }
+        }
+
+        if (argc>8 && (sscanf(argv[8],"%d",&p->numworkers)!=1 ||
+                       p->numworkers<1 ||
+                       p->numworkers>MAX_WORKERS))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of threads");
+            ok = 0;
+        }
+
+        // Every cell makes its own TLB as this one
+        memset (&S, 0, sizeof(S));
+
+        if (p->tlb && tlb_create(&S,p->tlb)<0)
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong TLB in %s", TLB_ENV);
+            ok = 0;
+        }
+
+        free_page_table (&S);
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n\n    USAGE:\n\t%s pagesizes frames alg initord "
+                          "numelem policies format threads\n\n",
+             argv[0]);
+
+    fprintf (stderr,
+             "\tpagesizes: list of page sizes (# of elements)\n"
+             "\tframes: list of numbers of page frames\n"
+             "\t     Lists are comma-separated numbers or ranges "
+                        "lo:hi (step 1),\n"
+             "\t     lo:hi:step or lo:hi:xfactor (geometric)\n"
+             "\talg: sorting algorithm (%s),\n"
+             "\t     or - to read a trace from the standard input,\n"
+             "\t     or the name of a file with a trace (with a / or a .)\n"
+             "\tinitord: initial state of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\tpolicies: comma-separated list of replacement "
+                         "policies (%s)\n"
+             "\tformat: CSV (default) or JSON\n"
+             "\tthreads: # of threads (by default, the # of "
+                        "processors)\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INIT_ORD, VALID_POLICIES);
+
+    fprintf (stderr,
+             "    EXAMPLES:\n"
+             "\t%s 4:64:x2 4:64:x2 MER RAN 1000\n"
+             "\t%s 16 1:32 HEA DES 1000 fifo,lru JSON 4\n"
+             "\n",
+             argv[0], argv[0]);
+
+    return -1;
+}
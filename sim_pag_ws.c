@@ -0,0 +1,249 @@
+/*
+    sim_pag_ws.c
+*/
+
+// Replacement with a variable number of frames: numframes is
+// only the most the process can have, and frames are given
+// back at the page faults.
+//
+// WS (working set, Denning): at every page fault, the pages
+// not referenced in the last S->window references (those out
+// of W(t,window), see calculate_ws.c) leave their frames.
+//
+// PFF (page fault frequency, Chu and Opderbeck): if more than
+// S->window references went by since the last page fault, so
+// that faults are rare, the pages not referenced since then
+// leave their frames; otherwise the process just gets one
+// more frame.
+//
+// Both keep the time of the last reference of every page, as
+// LRU(t) does, and replace the least recently used page when
+// the process already has numframes frames. The window is
+// taken from the environment variable WINDOW_ENV, if set.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./sim_paging.h"
+
+#define WS_WINDOW 1000    // Default windows
+#define PFF_WINDOW 100
+
+// Function that initialises the tables
+
+static void init_tables_window(ssystem* S, unsigned long long window) {
+  const char* env = getenv(WINDOW_ENV);
+  int i;
+
+  // Reset pages
+  clear_page_table(S);
+
+  // Split of addresses for this page size
+  init_translation(S);
+
+  // Reset time
+  S->clock = 0;
+  S->lastfault = 0;
+
+  if (env && strtoull(env, NULL, 10) > 0)
+    window = strtoull(env, NULL, 10);
+
+  S->window = window;
+
+  // Circular list of free frames
+  for (i = 0; i < S->numframes - 1; i++) {
+    S->frt[i].page = -1;
+    S->frt[i].next = i + 1;
+  }
+
+  S->frt[i].page = -1;  // Now i == numframes-1
+  S->frt[i].next = 0;   // Close circular list
+  S->listfree = i;      // Point to the last one
+}
+
+static void init_tables_ws(ssystem* S) {
+  init_tables_window(S, WS_WINDOW);
+}
+
+static void init_tables_pff(ssystem* S) {
+  init_tables_window(S, PFF_WINDOW);
+}
+
+// Functions that simulate the hardware of the MMU
+
+static void reference_page(ssystem* S, int page, char op) {
+  if (op == 'R') {              // If it's a read,
+    S->numrefsread++;           // count it
+  } else if (op == 'W') {       // If it's a write,
+    PAGE_MODIFIED(S, page) = 1; // count it and mark the
+    S->numrefswrite++;          // page 'modified'
+  }
+
+  PAGE_TIMESTAMP(S, page) = S->clock++;
+}
+
+static void reference_run(ssystem* S, int page,
+                          unsigned long long reads,
+                          unsigned long long writes) {
+  S->numrefsread += reads;
+  S->numrefswrite += writes;
+
+  if (writes)
+    PAGE_MODIFIED(S, page) = 1;
+
+  // Same marks as reads+writes calls to reference_page
+  S->clock += reads + writes;
+  PAGE_TIMESTAMP(S, page) = S->clock - 1;
+}
+
+// Functions that simulate the operating system
+
+// Releases the frames of the pages last referenced before time
+static void release_older(ssystem* S, unsigned long long time) {
+  int f, page;
+
+  for (f = 0; f < S->numframes; f++) {
+    page = S->frt[f].page;
+
+    if (page != -1 && PAGE_TIMESTAMP(S, page) < time)
+      release_frame(S, f);
+  }
+}
+
+static void page_fault_ws(ssystem* S, int page) {
+  if (S->clock > S->window)
+    release_older(S, S->clock - S->window);
+}
+
+static void page_fault_pff(ssystem* S, int page) {
+  if (S->clock - S->lastfault > S->window)
+    release_older(S, S->lastfault);
+
+  S->lastfault = S->clock;
+}
+
+static int choose_page_to_be_replaced(ssystem* S) {
+  int f, frame = 0;
+
+  // The least recently used page (every frame is occupied)
+  for (f = 1; f < S->numframes; f++)
+    if (PAGE_TIMESTAMP(S, S->frt[f].page) <
+        PAGE_TIMESTAMP(S, S->frt[frame].page))
+      frame = f;
+
+  STATS_SEARCH_COST(S, S->numframes);
+
+  if (S->detailed)
+    printf(
+        "@ Choosing (at %s) P%d of F%d to be "
+        "replaced\n",
+        S->policy->name, S->frt[frame].page, frame);
+
+  return S->frt[frame].page;
+}
+
+static void replace_page(ssystem* S, int victim, int newpage) {
+  int frame = PAGE_FRAME(S, victim);
+
+  if (PAGE_MODIFIED(S, victim)) {
+    if (S->detailed)
+      printf(
+          "@ Writing modified P%d back (to disc) to "
+          "replace it\n",
+          victim);
+
+    S->numpgwriteback++;
+  }
+
+  if (S->detailed)
+    printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
+
+  PAGE_PRESENT(S, victim) = 0;
+
+  PAGE_PRESENT(S, newpage) = 1;
+  PAGE_FRAME(S, newpage) = frame;
+  PAGE_MODIFIED(S, newpage) = 0;
+
+  S->frt[frame].page = newpage;
+}
+
+static void occupy_free_frame(ssystem* S, int frame, int page) {
+  if (S->detailed)
+    printf("@ Storing P%d in F%d\n", page, frame);
+
+  PAGE_PRESENT(S, page) = 1;
+  PAGE_FRAME(S, page) = frame;
+  PAGE_MODIFIED(S, page) = 0;
+
+  S->frt[frame].page = page;
+}
+
+// Functions that show results
+
+static void print_page_table(ssystem* S) {
+  int p;
+
+  printf("%10s %10s %10s %10s   %s\n", "PAGE", "Present", "Frame", "Modified", "Timestamp");
+
+  for (p = 0; p < S->numpags; p++)
+    if (PAGE_PRESENT(S, p))
+      printf("%8d   %6d     %8d   %6d   %8llu\n", p, PAGE_PRESENT(S, p),
+             PAGE_FRAME(S, p), PAGE_MODIFIED(S, p), PAGE_TIMESTAMP(S, p));
+    else
+      printf("%8d   %6d     %8s   %6s   %8llu\n", p, PAGE_PRESENT(S, p), "-",
+             "-", PAGE_TIMESTAMP(S, p));
+}
+
+static void print_frames_table(ssystem* S) {
+  int p, f;
+
+  printf("%10s %10s %10s\n", "FRAME", "Page", "Modified");
+
+  for (f = 0; f < S->numframes; f++) {
+    p = S->frt[f].page;
+
+    if (p == -1)
+      printf("%8d   %8s     %6s\n", f, "-", "-");
+    else
+      printf("%8d   %8d     %6d\n", f, p, PAGE_MODIFIED(S, p));
+  }
+}
+
+static void print_replacement_report(ssystem* S) {
+  printf("%s replacement (Window: %llu references, %d of %d frames "
+         "in use)\n",
+         S->policy->name, S->window, S->numoccupied, S->numframes);
+}
+
+// Replacement policies
+
+const spolicy policy_ws = {
+  "WS",
+  init_tables_ws,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report,
+  NULL,
+  page_fault_ws
+};
+
+const spolicy policy_pff = {
+  "PFF",
+  init_tables_pff,
+  reference_page,
+  reference_run,
+  choose_page_to_be_replaced,
+  replace_page,
+  occupy_free_frame,
+  print_page_table,
+  print_frames_table,
+  print_replacement_report,
+  NULL,
+  page_fault_pff
+};
@@ -0,0 +1,869 @@
+/*
+    sim_paging.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "sim_paging.h"
+
+static void tlb_clear (stlb * T);
+static void pgt_clear (sradix * X);
+
+// Functions that handle the page table
+
+int alloc_page_table (ssystem * S)
+{
+#ifdef SIM_PAGING_SOA
+    S->pgt.present = (char*) malloc (S->numpags);
+    S->pgt.frame = (int32_t*) malloc (S->numpags*sizeof(int32_t));
+    S->pgt.modified = (char*) malloc (S->numpags);
+    S->pgt.referenced = (char*) malloc (S->numpags);
+    S->pgt.timestamp = (unsigned long long*)
+                       malloc (S->numpags*sizeof(unsigned long long));
+
+    if (!S->pgt.present || !S->pgt.frame || !S->pgt.modified ||
+        !S->pgt.referenced || !S->pgt.timestamp)
+        return -1;
+#else
+    S->pgt = (spage*) malloc (S->numpags*sizeof(spage));
+
+    if (!S->pgt)
+        return -1;
+#endif
+
+    return 0;
+}
+
+void clear_page_table (ssystem * S)
+{
+#ifdef SIM_PAGING_SOA
+    memset (S->pgt.present, 0, S->numpags);
+    memset (S->pgt.frame, 0, S->numpags*sizeof(int32_t));
+    memset (S->pgt.modified, 0, S->numpags);
+    memset (S->pgt.referenced, 0, S->numpags);
+    memset (S->pgt.timestamp, 0,
+            S->numpags*sizeof(unsigned long long));
+#else
+    memset (S->pgt, 0, S->numpags*sizeof(spage));
+#endif
+
+    // No frame is occupied yet
+    S->numoccupied = 0;
+    S->framerefs = 0;
+
+    if (S->tlb)
+        tlb_clear (S->tlb);
+
+    if (S->radix)
+        pgt_clear (S->radix);
+}
+
+void free_page_table (ssystem * S)
+{
+    int l;
+
+    free (S->nextuse);
+    free (S->heap);
+    S->nextuse = NULL;
+    S->heap = NULL;
+
+    if (S->tlb)
+    {
+        free (S->tlb->entries);
+        free (S->tlb);
+        S->tlb = NULL;
+    }
+
+    if (S->radix)
+    {
+        for (l=0; l<S->radix->levels; l++)
+            free (S->radix->made[l]);
+
+        free (S->radix);
+        S->radix = NULL;
+    }
+
+#ifdef SIM_STATS
+    free (S->stats.windowfaults);
+    S->stats.windowfaults = NULL;
+    S->stats.numwindows = 0;
+#endif
+
+#ifdef SIM_PAGING_SOA
+    free (S->pgt.present);
+    free (S->pgt.frame);
+    free (S->pgt.modified);
+    free (S->pgt.referenced);
+    free (S->pgt.timestamp);
+    memset (&S->pgt, 0, sizeof(S->pgt));
+#else
+    free (S->pgt);
+    S->pgt = NULL;
+#endif
+}
+
+// Functions that gather the statistics
+
+#ifdef SIM_STATS
+
+static void stats_fault (ssystem * S)
+{
+    sstats * st = &S->stats;
+    size_t w, n;
+    unsigned long long * p;
+
+    w = st->numrefs / SIM_STATS_WINDOW;
+
+    if (w >= st->numwindows)
+    {
+        for (n=st->numwindows ? 2*st->numwindows : 64; n<=w; n*=2)
+            ;
+
+        p = (unsigned long long*)
+            realloc (st->windowfaults, n*sizeof(unsigned long long));
+
+        if (!p)
+            return;   // Windows are lost, but not the rest
+
+        memset (p+st->numwindows, 0,
+                (n-st->numwindows)*sizeof(unsigned long long));
+        st->windowfaults = p;
+        st->numwindows = n;
+    }
+
+    st->windowfaults[w] ++;
+}
+
+static void stats_search (ssystem * S)
+{
+    unsigned long long cost;
+    int b;
+
+    // Policies that do not search examine (only) the victim
+    cost = S->stats.searchcost ? S->stats.searchcost : 1;
+
+    for (b=0; b<STATS_HIST-1 && cost>>(b+1); b++)
+        ;
+
+    S->stats.searchhist[b] ++;
+    S->stats.searchcost = 0;
+}
+
+void print_stats (ssystem * S, FILE * pf)
+{
+    sstats * st = &S->stats;
+    size_t w, numwindows;
+    int b, last;
+
+    numwindows = (st->numrefs+SIM_STATS_WINDOW-1) / SIM_STATS_WINDOW;
+
+    for (last=STATS_HIST-1; last>0 && !st->searchhist[last]; last--)
+        ;
+
+    fprintf (pf, "{\"policy\":\"%s\",\"pagsz\":%d,\"frames\":%d,"
+                 "\"pages\":%d,\n", S->policy->name, S->pagsz,
+                 S->numframes, S->numpags);
+    fprintf (pf, " \"trace_seconds\":%.6f,\"sim_seconds\":%.6f,\n",
+             st->tracetime, st->simtime);
+    fprintf (pf, " \"references\":%llu,\"faults\":%llu,"
+                 "\"cold_faults\":%llu,\"capacity_faults\":%llu,\n",
+             st->numrefs, S->numpagefaults,
+             st->coldfaults, st->capacityfaults);
+    fprintf (pf, " \"search_hist\":[");
+
+    for (b=0; b<=last; b++)
+        fprintf (pf, "%s%llu", b ? "," : "", st->searchhist[b]);
+
+    fprintf (pf, "],\n \"window\":%d,\"window_faults\":[",
+             SIM_STATS_WINDOW);
+
+    for (w=0; w<numwindows; w++)
+        fprintf (pf, "%s%llu", w ? "," : "",
+                 w<st->numwindows ? st->windowfaults[w] : 0);
+
+    fprintf (pf, "]}\n");
+}
+
+#endif
+
+// Functions that write the event log
+
+static int evlog_write (int fd, const void * data, size_t size)
+{
+    const char * p = data;
+    ssize_t n;
+
+    for (; size; p+=n, size-=n)
+        if ((n = write (fd, p, size)) <= 0)
+            return -1;
+
+    return 0;
+}
+
+static void evlog_flush (sevlog * L)
+{
+    if (L->numevents &&
+        evlog_write (L->fd, L->buf, L->numevents*sizeof(sevent))<0)
+        L->error = 1;
+
+    L->numevents = 0;
+}
+
+static void evlog_put (sevlog * L, char type, char op,
+                       unsigned long long addr, int page, int frame)
+{
+    sevent * e;
+
+    if (L->t < L->t0 || L->t > L->t1 ||
+        (L->faultsonly && type==EV_REFERENCE))
+        return;
+
+    if (L->numevents == EV_BUFSZ)
+        evlog_flush (L);
+
+    e = &L->buf[L->numevents++];
+    e->t = L->t;
+    e->addr = (uint32_t) addr;
+    e->hi = (uint16_t) (addr >> 32);
+    e->page = page;
+    e->frame = frame;
+    e->type = type;
+    e->op = op;
+}
+
+int evlog_open (sevlog * L, int fd, const ssystem * S)
+{
+    sevheader H;
+
+    L->fd = fd;
+    L->error = 0;
+    L->t = 0;
+    L->numevents = 0;
+
+    memset (&H, 0, sizeof(H));
+    strcpy (H.magic, EV_MAGIC);
+    H.pagsz = S->pagsz;
+    H.numframes = S->numframes;
+    H.numpags = S->numpags;
+    strncpy (H.policy, S->policy->name, sizeof(H.policy)-1);
+
+    if (evlog_write (fd, &H, sizeof(H))<0)
+        L->error = 1;
+
+    return L->error ? -1 : 0;
+}
+
+int evlog_close (sevlog * L)
+{
+    evlog_flush (L);
+
+    return L->error ? -1 : 0;
+}
+
+// Functions that simulate the TLB
+
+int tlb_create (ssystem * S, const char * spec)
+{
+    stlb * T;
+    int entries, ways, n;
+    char repl[8] = "lru";
+
+    n = sscanf (spec, "%d:%d:%7s", &entries, &ways, repl);
+
+    if (n<2)
+        ways = entries;
+
+    if (n<1 || entries<1 || ways<1 || ways>entries ||
+        entries%ways || (strcmp(repl,"lru") && strcmp(repl,"random")))
+        return -1;
+
+    if (!(T = (stlb*) malloc (sizeof(stlb))))
+        return -1;
+
+    if (!(T->entries = (stlbentry*) malloc (entries*sizeof(stlbentry))))
+    {
+        free (T);
+        return -1;
+    }
+
+    T->numsets = entries / ways;
+    T->ways = ways;
+    T->random = repl[0]=='r';
+
+    tlb_clear (T);
+    S->tlb = T;
+
+    return 0;
+}
+
+static void tlb_clear (stlb * T)
+{
+    int e;
+
+    for (e=0; e<T->numsets*T->ways; e++)
+        T->entries[e].page = -1;
+
+    T->seed = 1;
+    T->clock = 0;
+    T->hits = T->misses = T->invalidations = 0;
+}
+
+// Looks page up for n references (a run), and returns its frame,
+// or -1 if it is not there (then only the first one is a miss)
+
+static inline int tlb_lookup (stlb * T, int page,
+                              unsigned long long n)
+{
+    stlbentry * e = &T->entries[page % T->numsets * T->ways];
+    int w;
+
+    T->clock += n;
+
+    for (w=0; w<T->ways; w++)
+        if (e[w].page == page)
+        {
+            e[w].last = T->clock;
+            T->hits += n;
+            return e[w].frame;
+        }
+
+    T->misses ++;
+    T->hits += n-1;
+
+    return -1;
+}
+
+// Puts the translation of page (just missed) in its set, in an
+// invalid entry if there is one, or else in place of the victim
+
+static void tlb_insert (stlb * T, int page, int frame)
+{
+    stlbentry * e = &T->entries[page % T->numsets * T->ways];
+    int w, victim;
+
+    for (w=0, victim=0; w<T->ways; w++)
+    {
+        if (e[w].page == -1)
+        {
+            victim = w;
+            break;
+        }
+
+        if (e[w].last < e[victim].last)
+            victim = w;
+    }
+
+    if (w==T->ways && T->random)
+    {
+        T->seed = T->seed*1103515245 + 12345;
+        victim = (T->seed>>16) % T->ways;
+    }
+
+    e[victim].page = page;
+    e[victim].frame = frame;
+    e[victim].last = T->clock;
+}
+
+static void tlb_invalidate (stlb * T, int page)
+{
+    stlbentry * e = &T->entries[page % T->numsets * T->ways];
+    int w;
+
+    for (w=0; w<T->ways; w++)
+        if (e[w].page == page)
+        {
+            e[w].page = -1;
+            T->invalidations ++;
+            break;
+        }
+}
+
+// Functions that simulate the radix page table
+
+int pgt_create (ssystem * S, const char * spec)
+{
+    sradix * X;
+    int levels, bits, pagebits, n, l;
+
+    for (pagebits=0; (1U<<pagebits) < (unsigned)S->numpags; pagebits++)
+        ;
+
+    n = sscanf (spec, "%d:%d", &levels, &bits);
+
+    if (n<1 || levels<1 || levels>PGT_MAX_LEVELS)
+        return -1;
+
+    if (n<2)
+        bits = pagebits ? (pagebits+levels-1) / levels : 1;
+
+    if (bits<1 || bits*levels>32 || bits*levels<pagebits)
+        return -1;
+
+    if (!(X = (sradix*) calloc (1, sizeof(sradix))))
+        return -1;
+
+    X->levels = levels;
+    X->bits = bits;
+
+    // The tables of level l cover 2^(bits*(levels-l)) pages
+    for (l=0; l<levels; l++)
+    {
+        X->size[l] = (((unsigned long long)S->numpags - 1) >>
+                      bits*(levels-l)) + 1;
+
+        if (!(X->made[l] = (char*) malloc (X->size[l])))
+        {
+            while (l-- > 0)
+                free (X->made[l]);
+
+            free (X);
+            return -1;
+        }
+    }
+
+    pgt_clear (X);
+    S->radix = X;
+
+    return 0;
+}
+
+static void pgt_clear (sradix * X)
+{
+    int l;
+
+    for (l=0; l<X->levels; l++)
+    {
+        memset (X->made[l], 0, X->size[l]);
+        X->numtables[l] = 0;
+    }
+
+    X->made[0][0] = 1;  // Only the root
+    X->numtables[0] = 1;
+    X->walks = X->accesses = 0;
+}
+
+// n walks to page: they go down while there are tables
+
+static inline void pgt_walk (sradix * X, int page,
+                             unsigned long long n)
+{
+    int l;
+
+    for (l=1; l<X->levels &&
+              X->made[l][page >> X->bits*(X->levels-l)]; l++)
+        ;
+
+    X->walks += n;
+    X->accesses += n*l;
+}
+
+// Makes the tables that are missing on the way to page
+
+static void pgt_map (sradix * X, int page)
+{
+    unsigned t;
+    int l;
+
+    for (l=1; l<X->levels; l++)
+    {
+        t = page >> X->bits*(X->levels-l);
+
+        if (!X->made[l][t])
+        {
+            X->made[l][t] = 1;
+            X->numtables[l] ++;
+        }
+    }
+}
+
+// Function that sets the huge pages up
+
+int huge_create (ssystem * S, const char * spec, unsigned totalsz)
+{
+    unsigned factor, start;
+    int n;
+
+    n = sscanf (spec, "%u:%u", &factor, &start);
+
+    if (n<1 || factor<2 || factor > INT_MAX / S->pagsz)
+        return -1;
+
+    if (n<2)
+        start = totalsz / 2;
+
+    // Small pages are never cut
+    start = (start+S->pagsz-1) / S->pagsz * S->pagsz;
+
+    if (start >= totalsz)
+        return (totalsz+S->pagsz-1) / S->pagsz;  // None is huge
+
+    S->hugesz = factor * S->pagsz;
+    S->hugestart = start;
+    S->hugefirst = start / S->pagsz;
+
+    return S->hugefirst + (totalsz-start+S->hugesz-1) / S->hugesz;
+}
+
+// Functions that simulate the hardware of the MMU
+
+void init_translation (ssystem * S)
+{
+    int shift;
+
+    for (shift=0; (1U<<shift) < (unsigned)S->pagsz; shift++)
+        ;
+
+    if ((1U<<shift) == (unsigned)S->pagsz)
+    {
+        S->pagshift = shift;
+        S->pagmask = S->pagsz-1;
+    }
+    else
+    {
+        S->pagshift = -1;
+        S->pagmagic = UINT64_MAX / S->pagsz + 1;
+    }
+}
+
+// Splits an address into page and offset (see init_translation).
+// With M = ceil(2^64/d), the high 64 bits of M*a are a/d, and the
+// high 64 bits of (M*a mod 2^64)*d are a%d, for every 32-bit a
+// (Lemire et al., "Faster remainder by direct computation").
+
+static inline void translate (const ssystem * S, unsigned addr,
+                              int * ppage, int * poffset)
+{
+#ifdef __SIZEOF_INT128__
+    uint64_t low;
+#endif
+
+    if (S->hugesz && addr >= S->hugestart)
+    {
+        *ppage = S->hugefirst + (addr-S->hugestart) / S->hugesz;
+        *poffset = (addr-S->hugestart) % S->hugesz;
+        return;
+    }
+
+    if (S->pagshift >= 0)
+    {
+        *ppage = addr >> S->pagshift;
+        *poffset = addr & S->pagmask;
+        return;
+    }
+
+#ifdef __SIZEOF_INT128__
+    low = S->pagmagic * addr;
+    *ppage = (unsigned)(((unsigned __int128)S->pagmagic * addr) >> 64);
+    *poffset = (unsigned)(((unsigned __int128)low * S->pagsz) >> 64);
+#else
+    *ppage = addr / S->pagsz;
+    *poffset = addr % S->pagsz;
+#endif
+}
+
+// Physical address of a frame (all of them are as long as a
+// huge page, if there are huge pages)
+
+static inline unsigned frame_base (const ssystem * S, int frame)
+{
+    return (unsigned)frame * (S->hugesz ? S->hugesz : S->pagsz);
+}
+
+int address_page (const ssystem * S, unsigned virtual_addr)
+{
+    int page, offset;
+
+    translate (S, virtual_addr, &page, &offset);
+
+    return page;
+}
+
+unsigned sim_mmu (ssystem * S, unsigned virtual_addr, char op)
+{
+    unsigned physical_addr;
+    int page, frame, offset;
+
+    translate (S, virtual_addr, &page, &offset);
+
+    if (page<0 || page>=S->numpags)
+    {
+        S->numillegalrefs ++;  // References out of range
+
+        if (S->evlog)
+            S->evlog->t ++;
+
+        return ~0U;            // Return invalid physical 0xFFF..F
+    }
+
+    // With a TLB, the page table is only looked at on a miss
+    if (!S->tlb || (frame = tlb_lookup (S->tlb, page, 1)) < 0)
+    {
+        if (S->tlb && S->detailed)
+            printf ("@ TLB_MISS in P %d\n", page);
+
+        if (!PAGE_PRESENT(S, page))
+        {
+            if (S->radix)
+                pgt_walk (S->radix, page, 1);
+
+            // Not present: trigger page fault exception
+            handle_page_fault (S, virtual_addr);
+        }
+
+        // Now it is present
+        frame = PAGE_FRAME(S, page);
+
+        if (S->radix)
+            pgt_walk (S->radix, page, 1);
+
+        if (S->tlb)
+            tlb_insert (S->tlb, page, frame);
+    }
+
+    physical_addr = frame_base (S, frame) + offset;
+
+    S->policy->reference_page (S, page, op);
+    S->framerefs += S->numoccupied;
+
+#ifdef SIM_STATS
+    S->stats.numrefs ++;
+#endif
+
+    if (S->detailed)
+        printf ("\t %c %u==P %d(M %d)+ %d\n",
+                op, virtual_addr, page, frame, offset);
+
+    if (S->evlog)
+    {
+        evlog_put (S->evlog, EV_REFERENCE, op, virtual_addr,
+                   page, frame);
+        S->evlog->t ++;
+    }
+
+    return physical_addr;
+}
+
+unsigned sim_mmu_run (ssystem * S, unsigned virtual_addr,
+                      unsigned long long reads,
+                      unsigned long long writes)
+{
+    int page, offset;
+
+    translate (S, virtual_addr, &page, &offset);
+
+    if (page<0 || page>=S->numpags)
+    {
+        S->numillegalrefs += reads+writes;
+
+        if (S->evlog)
+            S->evlog->t += reads+writes;
+
+        return ~0U;
+    }
+
+    if (!S->tlb || tlb_lookup (S->tlb, page, reads+writes) < 0)
+    {
+        if (!PAGE_PRESENT(S, page))
+        {
+            if (S->radix)
+                pgt_walk (S->radix, page, 1);
+
+            handle_page_fault (S, virtual_addr);
+        }
+
+        // With a TLB, only the first reference walks
+        if (S->radix)
+            pgt_walk (S->radix, page, S->tlb ? 1 : reads+writes);
+
+        if (S->tlb)
+            tlb_insert (S->tlb, page, PAGE_FRAME(S, page));
+    }
+
+    S->policy->reference_run (S, page, reads, writes);
+    S->framerefs += (reads+writes) * S->numoccupied;
+
+    if (S->evlog)
+        S->evlog->t += reads+writes;
+
+#ifdef SIM_STATS
+    S->stats.numrefs += reads+writes;
+#endif
+
+    return frame_base (S, PAGE_FRAME(S, page)) + offset;
+}
+
+// Functions that fold the references into runs
+
+void run_start (srun * R)
+{
+    R->page = -1;
+    R->reads = R->writes = 0;
+}
+
+void run_reference (ssystem * S, srun * R,
+                    unsigned virtual_addr, char op)
+{
+    int page, offset;
+
+    translate (S, virtual_addr, &page, &offset);
+
+    if (page != R->page)
+    {
+        run_flush (S, R);
+        R->page = page;
+        R->addr = virtual_addr;
+    }
+
+    if (op=='W')
+        R->writes ++;
+    else
+        R->reads ++;
+}
+
+void run_flush (ssystem * S, srun * R)
+{
+    if (R->reads+R->writes)
+        sim_mmu_run (S, R->addr, R->reads, R->writes);
+
+    run_start (R);
+}
+
+// Functions that simulate the operating system
+
+void handle_page_fault (ssystem * S, unsigned virtual_addr)
+{
+    int page, offset, victim, frame, last;
+    unsigned long long writebacks;
+    size_t nextuse = 0;
+
+    S->numpagefaults ++;
+    translate (S, virtual_addr, &page, &offset);
+
+#ifdef SIM_STATS
+    stats_fault (S);
+#endif
+
+    if (S->detailed)
+        printf ("@ PAGE_FAULT in P %d!\n", page);
+
+    if (S->evlog)
+        evlog_put (S->evlog, EV_FAULT, 0, virtual_addr, page, -1);
+
+    if (S->policy->page_fault)
+        // It may release frames
+        S->policy->page_fault (S, page);
+
+    if (S->listfree != -1)
+    {
+        // There are free frames
+        last = S->listfree;
+        frame = S->frt[last].next;
+
+        if (frame==last)
+            // Then, this is the last one left.
+            S->listfree = -1;
+        else
+            // Otherwise, bypass
+            S->frt[last].next = S->frt[frame].next;
+
+        S->policy->occupy_free_frame (S, frame, page);
+        S->numoccupied ++;
+
+        if (S->evlog)
+            evlog_put (S->evlog, EV_STORE, 0, virtual_addr, page, frame);
+
+#ifdef SIM_STATS
+        S->stats.coldfaults ++;
+#endif
+    }
+    else
+    {
+        // There are not free frames
+        victim = S->policy->choose_page_to_be_replaced (S);
+        writebacks = S->numpgwriteback;
+
+        // The next use of the victim (only OPT has them) is
+        // gone after replace_page
+        if (S->evlog && S->nextuse)
+            nextuse = S->frt[PAGE_FRAME(S, victim)].nextuse;
+
+        S->policy->replace_page (S, victim, page);
+
+        if (S->tlb)
+            tlb_invalidate (S->tlb, victim);
+
+        if (S->evlog)
+        {
+            frame = PAGE_FRAME(S, page);
+
+            if (!S->nextuse)
+                evlog_put (S->evlog, EV_CHOOSE, 0, victim, victim,
+                           frame);
+            else if (nextuse == SIZE_MAX)  // NEVER in sim_pag_opt.c
+                evlog_put (S->evlog, EV_CHOOSE, 'N', 0, victim, frame);
+            else
+                evlog_put (S->evlog, EV_CHOOSE, 'U', nextuse, victim,
+                           frame);
+
+            if (S->numpgwriteback != writebacks)
+                evlog_put (S->evlog, EV_WRITEBACK, 0, victim,
+                           victim, frame);
+
+            evlog_put (S->evlog, EV_REPLACE, 0, victim, page, frame);
+        }
+
+#ifdef SIM_STATS
+        S->stats.capacityfaults ++;
+        stats_search (S);
+#endif
+    }
+
+    if (S->radix)
+        pgt_map (S->radix, page);
+}
+
+void release_frame (ssystem * S, int frame)
+{
+    int page = S->frt[frame].page;
+
+    if (S->detailed)
+        printf ("@ Releasing P%d of F%d\n", page, frame);
+
+    if (S->evlog)
+        evlog_put (S->evlog, EV_RELEASE, 0, 0, page, frame);
+
+    if (PAGE_MODIFIED(S, page))
+    {
+        if (S->detailed)
+            printf ("@ Writing modified P%d back (to disc) to "
+                    "release it\n", page);
+
+        if (S->evlog)
+            evlog_put (S->evlog, EV_WRITEBACK, EV_RELEASE, page, page,
+                       frame);
+
+        S->numpgwriteback ++;
+    }
+
+    PAGE_PRESENT(S, page) = 0;
+    S->frt[frame].page = -1;
+    S->numoccupied --;
+
+    if (S->tlb)
+        tlb_invalidate (S->tlb, page);
+
+    // At the end of the circular list of free frames
+    if (S->listfree == -1)
+        S->frt[frame].next = frame;
+    else
+    {
+        S->frt[frame].next = S->frt[S->listfree].next;
+        S->frt[S->listfree].next = frame;
+    }
+
+    S->listfree = frame;
+}
@@ -5,6 +5,10 @@
 #ifndef _SIM_PAGING_H_
 #define _SIM_PAGING_H_
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
 // Structure that holds the state of a page,
 // sumulating an entry of the page table
 
@@ -18,7 +22,7 @@ typedef struct
     char referenced;    // 1 = page referenced recently
 
     // For LRU(t)
-    unsigned timestamp; // Time mark of last reference
+    unsigned long long timestamp; // Time mark of last reference
 
     // NOTE: The previous two fiels are in this structure
     //       ---and not in sframe--- because they simulate
@@ -27,6 +31,44 @@ typedef struct
 }
 spage;
 
+// With -DSIM_PAGING_SOA the page table is kept instead as a
+// structure of arrays, one per field (frames as a dense array
+// of int32_t), so that the LRU victim scan only touches the
+// timestamps and sim_mmu only the present flags and frames.
+// The policies reach the fields of page P of system S through
+// these macros, which work with both layouts (as values and
+// as lvalues).
+
+#ifdef SIM_PAGING_SOA
+
+typedef struct
+{
+    char * present;
+    int32_t * frame;
+    char * modified;
+    char * referenced;
+    unsigned long long * timestamp;
+}
+spagetable;
+
+#define PAGE_PRESENT(S,P)    ((S)->pgt.present[P])
+#define PAGE_FRAME(S,P)      ((S)->pgt.frame[P])
+#define PAGE_MODIFIED(S,P)   ((S)->pgt.modified[P])
+#define PAGE_REFERENCED(S,P) ((S)->pgt.referenced[P])
+#define PAGE_TIMESTAMP(S,P)  ((S)->pgt.timestamp[P])
+
+#else
+
+typedef spage * spagetable;
+
+#define PAGE_PRESENT(S,P)    ((S)->pgt[P].present)
+#define PAGE_FRAME(S,P)      ((S)->pgt[P].frame)
+#define PAGE_MODIFIED(S,P)   ((S)->pgt[P].modified)
+#define PAGE_REFERENCED(S,P) ((S)->pgt[P].referenced)
+#define PAGE_TIMESTAMP(S,P)  ((S)->pgt[P].timestamp)
+
+#endif
+
 // Structure that holds the state of a frame
 // (the hardware doesn't know anything about this struct)
 
@@ -36,58 +78,438 @@ typedef struct
 
     // For managing free frames and for FIFO and FIFO 2nd ch.
     int next;           // Next frame in the list
+
+    // For the LRU recency list (doubly linked with next)
+    int prev;           // Previous frame in the list
+
+    // For GCLOCK
+    int count;          // Times found referenced by the hand
+
+    // For OPT
+    size_t nextuse;     // Next reference to its page
+    int heappos;        // Position in S->heap
 }
 sframe;
 
+// Replacement policy (defined below)
+
+typedef struct spolicy spolicy;
+
+// With -DSIM_STATS, every system also gathers statistics that
+// cost nothing otherwise: page faults with free frames (cold)
+// and with replacement (capacity), a histogram of the # of
+// frames examined by choose_page_to_be_replaced (bucket b for
+// 2^b to 2^(b+1)-1 frames), the page faults of every window of
+// SIM_STATS_WINDOW references, and the time spent taking the
+// trace and simulating it (filled in by the program). The
+// policies count the frames they examine with
+// STATS_SEARCH_COST, and print_stats writes it all as JSON.
+
+#ifdef SIM_STATS
+
+#ifndef SIM_STATS_WINDOW
+#define SIM_STATS_WINDOW 10000
+#endif
+
+#define STATS_HIST 32
+
+typedef struct
+{
+    unsigned long long coldfaults, capacityfaults;
+    unsigned long long searchcost;     // Of the current search
+    unsigned long long searchhist[STATS_HIST];
+    unsigned long long numrefs;        // References in range
+    unsigned long long * windowfaults; // Faults of each window
+    size_t numwindows;                 // Size of windowfaults
+    double tracetime, simtime;         // Seconds
+}
+sstats;
+
+#define STATS_SEARCH_COST(S,N) ((S)->stats.searchcost += (N))
+
+#else
+
+#define STATS_SEARCH_COST(S,N) ((void)0)
+
+#endif
+
+// Event log: instead of the text of the detailed mode, the
+// simulation can write compact records of what happens (one
+// per reference and a few more per page fault) through a
+// large buffer to a file descriptor. Only the events of the
+// references t0..t1 (counted from 0, out of range ones too)
+// are written, and without the references themselves if
+// faultsonly is set. decode_events prints them back with the
+// layout of the detailed mode. In mode C there is one event of
+// each kind per run, at its first reference, and no
+// EV_REFERENCE.
+
+#define EV_MAGIC "SIMEVT1"
+
+#define EV_REFERENCE 'R'   // op, addr, page and frame
+#define EV_FAULT     'F'   // page
+#define EV_STORE     'S'   // page stored in a free frame
+#define EV_CHOOSE    'C'   // page (the victim) and its frame;
+                           // with OPT, op is 'U' and addr and
+                           // hi the next use of the victim, or
+                           // op is 'N' if it is not used again
+#define EV_WRITEBACK 'W'   // page (the victim; op is EV_RELEASE
+                           // if it is released)
+#define EV_REPLACE   'X'   // page (the new one), addr (the
+                           // victim) and frame
+#define EV_RELEASE   'L'   // page and the frame it leaves
+
+typedef struct
+{
+    uint64_t t;            // # of the reference
+    uint32_t addr;
+    int32_t page, frame;
+    char type, op;
+    uint16_t hi;           // Bits 32 to 47 of a next use
+}
+sevent;
+
+typedef struct
+{
+    char magic[8];         // EV_MAGIC
+    int32_t pagsz, numframes, numpags;
+    char policy[36];       // Name of the policy
+}
+sevheader;
+
+#define EV_BUFSZ 4096      // Events in the buffer (96 KiB)
+
+typedef struct
+{
+    int fd;
+    int error;             // 1 = some write failed
+    unsigned long long t;  // Next reference
+    unsigned long long t0, t1;
+    char faultsonly;
+    int numevents;         // Events in buf
+    sevent buf[EV_BUFSZ];
+}
+sevlog;
+
+// TLB: an optional cache of translations in front of the page
+// table, with numsets sets of ways entries (page P goes in set
+// P % numsets), replacing the least recently used entry of the
+// set or a random one. sim_mmu and sim_mmu_run look every
+// reference up there first, and only go to the page table on a
+// miss (counting one translation for every reference of a
+// run). The entry of a page is invalidated when the page
+// leaves its frame (in handle_page_fault, after replace_page,
+// and in release_frame), so the results of the simulation do
+// not change with it. It is described as entries[:ways[:lru
+// or random]] (fully associative if ways is left out), for
+// instance in the environment variable TLB_ENV.
+
+#define TLB_ENV "SIM_TLB"
+
+typedef struct
+{
+    int page;              // -1 = invalid
+    int frame;
+    unsigned long long last;   // Time of the last use (LRU)
+}
+stlbentry;
+
+typedef struct
+{
+    int numsets, ways;
+    char random;           // 1 = random replacement, 0 = LRU
+    unsigned seed;         // Random numbers of its own
+    unsigned long long clock;  // Lookups so far
+    unsigned long long hits, misses;
+    unsigned long long invalidations;
+    stlbentry * entries;   // numsets x ways
+}
+stlb;
+
+// Radix page table: an optional model of a page table of
+// levels levels (PGT_MAX_LEVELS at most), where the page number
+// is split into fields of bits bits, one per level, and every
+// table has 2^bits entries of PGT_ENTRY_BYTES. Only the root is
+// there at first; the tables below it are made on demand, the
+// first time one of their pages is brought in by
+// handle_page_fault, and are not freed when the page leaves
+// its frame. Every translation that goes to the page table (all
+// of them, or only the misses of the TLB if there is one) is a
+// walk from the root, with one memory access per level, which
+// stops early at an entry with no table below (a reference
+// that causes a page fault walks once before it and once
+// after it, when it is done again). The page table
+// the policies use is still the flat one; this only counts the
+// tables and the accesses that the radix one would have. It is
+// described as levels[:bits] (bits enough to cover the pages by
+// default), for instance in the environment variable
+// PGTABLE_ENV.
+
+#define PGTABLE_ENV "SIM_PGTABLE"
+#define PGT_MAX_LEVELS 3
+#define PGT_ENTRY_BYTES 8
+
+typedef struct
+{
+    int levels, bits;
+    unsigned size[PGT_MAX_LEVELS];       // Tables there can be
+    unsigned numtables[PGT_MAX_LEVELS];  // Made so far, by level
+    char * made[PGT_MAX_LEVELS];   // Whether each table exists
+    unsigned long long walks, accesses;
+}
+sradix;
+
+// Huge pages: optionally, the addresses from hugestart on (the
+// last part of the address space, for instance the second half
+// of the space of MER, which it uses as a whole) go in pages of
+// hugesz elements, a multiple of pagsz, so that the pages from
+// hugefirst on are huge ones. Each of them takes one frame, so
+// every frame is then hugesz long (a small page uses only the
+// start of its frame), and the same numframes are more memory
+// than without huge pages. They are described as
+// factor[:start], with hugesz = factor*pagsz and start (rounded
+// up to a multiple of pagsz) half the space by default, for
+// instance in the environment variable HUGE_ENV.
+
+#define HUGE_ENV "SIM_HUGE"
+
 // Struture that contains the state of the whole system
 
 typedef struct
 {
+    const spolicy * policy;  // Replacement policy in use
+
     // Page table (maintained by HW and OS)
     int pagsz;
+    int pagshift;          // log2(pagsz), -1 if not a power of 2
+    unsigned pagmask;      // pagsz-1, if it is a power of 2
+    uint64_t pagmagic;     // 2^64/pagsz rounded up, otherwise
+    int hugesz;            // Size of the huge pages (0 = none)
+    unsigned hugestart;    // First address in a huge page
+    int hugefirst;         // First huge page
     int numpags;
-    spage * pgt;
-    int lru;               // Only for LRU replacement
-    unsigned clock;        // Only for LRU(t) replacement
+    spagetable pgt;
+    int lru;               // Only for LRU replacement (list)
+    unsigned long long clock;  // Only for LRU(t) replacement
 
     // Frames table (maintained by the OS only)
     int numframes;
     sframe * frt;
     int listfree;
     int listoccupied;      // Only for FIFO and FIFO 2nd ch.
+    int hand;              // Only for CLOCK and GCLOCK
+    int numoccupied;       // Frames not in the free list
+    unsigned long long framerefs;  // Sum of numoccupied at
+                                   // every reference
+
+    // Only for WS and PFF (see sim_pag_ws.c): the window, in
+    // references, taken from WINDOW_ENV or a default
+    unsigned long long window;
+    unsigned long long lastfault;  // Time of the last fault
+
+    // Only for OPT replacement (see prepare_trace)
+    size_t * nextuse;      // Next use of the page of each reference
+    size_t now;            // # of references simulated so far
+    int * heap;            // Frames, by the next use of their pages
+    int heapsize;
+
+    // Random numbers (only for random replacement); every
+    // system has its own sequence, so that several of them
+    // can be simulated at the same time
+    struct random_data randdata;
+    char randstate[128];
 
-    // Trace data
-    int numrefsread;       // Counter of read operations
-    int numrefswrite;      // Counter of write operations
-    int numpagefaults;     // Counter of page faults
-    int numpgwriteback;    // Counter of write back (to disc) ops.
-    int numillegalrefs;    // References out of range
+    // Trace data (64-bit: large O(n^2) sorts make more than
+    // 2^32 references)
+    unsigned long long numrefsread;     // Counter of read operations
+    unsigned long long numrefswrite;    // Counter of write operations
+    unsigned long long numpagefaults;   // Counter of page faults
+    unsigned long long numpgwriteback;  // Counter of write back ops.
+    unsigned long long numillegalrefs;  // References out of range
     char detailed;         // 1 = show step-by-step information
+    sevlog * evlog;        // Event log (NULL = none)
+    stlb * tlb;            // TLB (NULL = none)
+    sradix * radix;        // Radix page table (NULL = none)
+
+#ifdef SIM_STATS
+    sstats stats;
+#endif
 }
 ssystem;
 
+// Types of the functions that implement a replacement
+// policy. The hardware and the part of the operating system
+// that are common to every policy (sim_mmu and
+// handle_page_fault) reach them through S->policy.
+
 // Function that initialises the tables
+typedef void function_init_tables (ssystem * S);
+
+// Function that simulates the hardware of the MMU
+typedef void function_reference_page (ssystem * S, int page, char op);
+
+// Same as reads+writes consecutive calls to reference_page for
+// the same page (in any order), which must be present
+typedef void function_reference_run (ssystem * S, int page,
+                                     unsigned long long reads,
+                                     unsigned long long writes);
+
+// Functions that simulate the operating system
+typedef int function_choose_page (ssystem * S);
+typedef void function_replace_page (ssystem * S, int victim, int newpage);
+typedef void function_occupy_free_frame (ssystem * S, int frame, int page);
+
+// Functions that show results
+typedef void function_print (ssystem * S);
+
+// Function that receives the whole trace before the simulation
+// (refs as in TRACE_REF of trace.h, comparisons included or
+// not), for the policies that need to know the future. Returns
+// -1 if there is not enough memory. What it reserves is freed
+// by free_page_table.
+typedef int function_prepare_trace (ssystem * S, const unsigned * refs,
+                                    size_t numrefs);
+
+// Function called at the start of every page fault, before a
+// frame is looked for, by the policies that change the # of
+// frames of the process (at most numframes): it can give
+// frames back with release_frame.
+typedef void function_page_fault (ssystem * S, int page);
+
+struct spolicy
+{
+    const char * name;
+    function_init_tables * init_tables;
+    function_reference_page * reference_page;
+    function_reference_run * reference_run;
+    function_choose_page * choose_page_to_be_replaced;
+    function_replace_page * replace_page;
+    function_occupy_free_frame * occupy_free_frame;
+    function_print * print_page_table;
+    function_print * print_frames_table;
+    function_print * print_replacement_report;
+    function_prepare_trace * prepare_trace;  // NULL (or left
+                                             // out) if not needed
+    function_page_fault * page_fault;        // NULL (or left
+                                             // out) with a fixed
+                                             // # of frames
+};
+
+// Available replacement policies (one per sim_pag_*.c)
+
+extern const spolicy policy_random, policy_fifo, policy_fifo2ch,
+                     policy_lru, policy_lru_list,
+                     policy_clock, policy_gclock, policy_opt,
+                     policy_ws, policy_pff;
+
+// Looks for a policy by the (first len characters of the) name
+// used in the command line. NULL if it is unknown. Only in the
+// programs that link all of them (sim_policies.c).
+
+#define VALID_POLICIES "random,fifo,fifo2ch,lru,lru_list,clock,gclock," \
+                       "ws,pff"
+
+// Environment variable with the window of WS and PFF
 
-void init_tables (ssystem * S);
+#define WINDOW_ENV "SIM_WINDOW"
+
+const spolicy * find_policy (const char * name, int len);
+
+// Name of a policy in the command line (NULL if it is unknown)
+
+const char * policy_key (const spolicy * policy);
 
 // Functions that simulate the hardware of the MMU
 
+// Chooses once (the policies call it from init_tables) how
+// addresses are split into page and offset: with a shift and
+// a mask if the page size is a power of two, or with a
+// multiplication by the inverse of the size otherwise, so that
+// no reference costs a hardware divide
+
+void init_translation (ssystem * S);
+
+// Page of an address (which may be out of range)
+
+int address_page (const ssystem * S, unsigned virt_address);
+
 unsigned sim_mmu (ssystem * S, unsigned virt_address, char op);
-void reference_page (ssystem * S, int page, char op);
+
+// Runs of consecutive references to the same page. Only the
+// first reference of a run can cause a page fault, so the
+// whole run is simulated at once by sim_mmu_run, with the
+// same results as sim_mmu reference by reference (but without
+// the detailed information).
+
+typedef struct
+{
+    int page;                  // Page of the run (-1 = none)
+    unsigned addr;             // Address of its first reference
+    unsigned long long reads, writes;  // # of refs. of each kind
+}
+srun;
+
+unsigned sim_mmu_run (ssystem * S, unsigned virt_address,
+                      unsigned long long reads,
+                      unsigned long long writes);
+
+void run_start (srun * R);
+void run_reference (ssystem * S, srun * R,
+                    unsigned virt_address, char op);
+void run_flush (ssystem * S, srun * R);
+
+// Functions that reserve (for S->numpags pages), clear and
+// free the page table. alloc_page_table returns -1 if there is
+// not enough memory. clear_page_table also empties the TLB and
+// the radix page table, and free_page_table also frees them
+// and the tables of prepare_trace and of the statistics.
+
+int alloc_page_table (ssystem * S);
+void clear_page_table (ssystem * S);
+void free_page_table (ssystem * S);
 
 // Functions that simulate the operating system
 
 void handle_page_fault (ssystem * S, unsigned virt_address);
-int choose_page_to_be_replaced (ssystem * S);
-void replace_page (ssystem * S, int victim, int newpage);
-void occupy_free_frame (ssystem * S, int frame, int page);
+
+// Takes the page out of the frame (writing it back if it was
+// modified) and puts the frame at the end of the list of free
+// frames (only from page_fault)
+
+void release_frame (ssystem * S, int frame);
+
+// Gives S a TLB as described in spec (see TLB_ENV), empty.
+// Returns -1 if spec is wrong or there is not enough memory.
+
+int tlb_create (ssystem * S, const char * spec);
+
+// Gives S (with S->numpags set) a radix page table as
+// described in spec (see PGTABLE_ENV), with only the root.
+// Returns -1 if spec is wrong or there is not enough memory.
+
+int pgt_create (ssystem * S, const char * spec);
+
+// Makes the pages of S (with S->pagsz set) from the address
+// given in spec (see HUGE_ENV) on huge, for an address space of
+// totalsz elements. Returns the number of pages that the space
+// takes then, or -1 if spec is wrong.
+
+int huge_create (ssystem * S, const char * spec, unsigned totalsz);
 
 // Functions that show results
 
 void print_report (ssystem * S);
-void print_page_table (ssystem * S);
-void print_frames_table (ssystem * S);
-void print_replacement_report (ssystem * S);
+
+#ifdef SIM_STATS
+void print_stats (ssystem * S, FILE * pf);
+#endif
+
+// Functions that write the event log of S. The filters (t0, t1
+// and faultsonly) must be set before the simulation. They
+// return -1 if a write fails.
+
+int evlog_open (sevlog * L, int fd, const ssystem * S);
+int evlog_close (sevlog * L);
 
 #endif // _SIM_PAGING_H_
 
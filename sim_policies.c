@@ -0,0 +1,49 @@
+/*
+    sim_policies.c
+*/
+
+#include <string.h>
+
+#include "sim_paging.h"
+
+// Replacement policies that can be simulated, and the names
+// used to choose them in the command line
+
+static const struct
+{
+    const spolicy * policy;
+    const char * name;
+}
+policies[] = { { &policy_random, "random" },
+               { &policy_fifo, "fifo" },
+               { &policy_fifo2ch, "fifo2ch" },
+               { &policy_lru, "lru" },
+               { &policy_lru_list, "lru_list" },
+               { &policy_clock, "clock" },
+               { &policy_gclock, "gclock" },
+               { &policy_ws, "ws" },
+               { &policy_pff, "pff" },
+               { NULL, NULL } };
+
+const spolicy * find_policy (const char * name, int len)
+{
+    unsigned u;
+
+    for (u=0; policies[u].name; u++)
+        if (strlen(policies[u].name)==len &&
+            !strncmp(policies[u].name,name,len))
+            break;
+
+    return policies[u].policy;
+}
+
+const char * policy_key (const spolicy * policy)
+{
+    unsigned u;
+
+    for (u=0; policies[u].name; u++)
+        if (policies[u].policy==policy)
+            break;
+
+    return policies[u].name;
+}
@@ -31,6 +31,7 @@ typedef unsigned function_sort(void *, unsigned size,
 // Declaration of the different sorting functions:
 
 function_sort bubble_sort, insertion_sort, selection_sort, heap_sort, comb_sort,
-    merge_sort, quick_sort, quick_sort_pa;
+    merge_sort, quick_sort, quick_sort_pa, merge_sort_bu, intro_sort, radix_sort,
+    merge_sort_ip;
 
 #endif  // SORT_H_
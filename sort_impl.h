@@ -0,0 +1,1023 @@
+/*
+    sort_impl.h
+*/
+
+// Template of the sorting algorithms: every inclusion of this
+// file defines all of them (and their helpers) as static
+// functions SORT_NAME(bubble_sort) ... SORT_NAME(merge_sort_ip),
+// with the signature
+//
+//     static unsigned SORT_NAME(alg) (SORT_CTX ctx, unsigned size)
+//
+// for the parameters defined before including it:
+//
+//     SORT_NAME(x)        Name of the instance of function x
+//     SORT_CTX            Type of the context (ctx)
+//     SORT_READ(c,pos)    Value of position pos (a thing)
+//     SORT_WRITE(c,pos,v) Stores v in position pos
+//     SORT_LESS(c,a,b)    Whether a goes before b
+//
+// sort.c makes, with them, the generic version of sort.h, which
+// reaches the array through function pointers. With macros
+// that access the array directly, the compiler can inline and
+// optimize each algorithm for a kind of sink (see tracegen.c),
+// while all versions make exactly the same operations, in the
+// same order. The parameters are undefined at the end, so that
+// the file can be included again.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort.h"
+
+#ifndef SORT_IMPL_H_
+#define SORT_IMPL_H_
+
+// Shared by every instance
+
+static const unsigned long combs[] =
+{
+    // This table uses coprime numbers. The ratio between any
+    // two consecutive numbers is lesser than the square root
+    // of 2.
+    // Watch out: the smallest values have been ommited;
+    //            the final insertion sort stage is always
+    //            necessary ---whether it takes O(N*N) or
+    //            just O(N) as usual, is another kettle of
+    //            fish.
+    5UL, 7UL,
+    9UL, // Watch out: 9 is not prime
+    11UL, 13UL, 17UL, 23UL, 31UL, 43UL, 59UL, 83UL, 113UL,
+    157UL, 211UL, 293UL, 409UL, 577UL, 811UL, 1129UL,
+    1583UL, 2237UL, 3163UL, 4463UL, 6311UL, 8923UL, 12619UL,
+    17839UL, 25219UL, 35617UL, 50363UL, 71209UL, 100703UL,
+    142403UL, 201359UL, 284759UL, 402697UL, 569497UL,
+    805381UL, 1138979UL, 1610753UL, 2277941UL, 3221473UL,
+    4555843UL, 6442897UL, 9111629UL, 12885751UL, 18223193UL,
+    25771469UL, 36446357UL, 51542927UL, 72892669UL,
+    103085789UL, 145785317UL, 206171569UL, 291570607UL,
+    412343081UL, 583141177UL, 824686151UL, 1166282329UL,
+    1649372281UL, 2332564607UL, 3298744483UL,
+    ~0UL
+};
+
+static inline unsigned my_random (unsigned from, unsigned size)
+{
+    unsigned n;
+
+    n = from + (unsigned)(rand()/(RAND_MAX+1.0)*size);
+
+    if (n>from+size-1)
+        n = from+size-1;
+    else if (n<from)
+        n = from;
+
+    return n;
+}
+
+// Length of the runs that the tiled algorithms sort with the
+// insertion method before merging them, and of the smallest
+// partition that introsort leaves to it
+
+#define SORT_RUN 16
+
+// Key of a thing for the radix sort: an unsigned integer with
+// the same order as the (double) value, made from its bits by
+// flipping the sign bit of the positive values and every bit
+// of the negative ones
+
+static inline unsigned long long sort_key (thing a)
+{
+    unsigned long long k = 0;
+
+    memcpy (&k, &a, sizeof(a));
+
+    return k>>63 ? ~k : k | 1ULL<<63;
+}
+
+#endif  // SORT_IMPL_H_
+
+// Sorting by the bubble method
+//     Stable:                yes
+//     Max complexity:        O(N*N)
+//     Average complexity:    O(N*N)
+//     Min complexity:        O(N)
+//     Other considerations:  It's the worst of all the usually
+//                            taught methods. Some even propose not
+//                            to toeach it ever again, and use the
+//                            insertion sort method instead.
+//                            The number of write operations can
+//                            be reduced by chaining the swap
+//                            operations, but it's not worth it
+//                            (it will be worse than insertion
+//                            anyway).
+
+static unsigned SORT_NAME(bubble_sort) (SORT_CTX ctx, unsigned size)
+{
+    int end;
+    unsigned u, iter;
+    thing a, b;
+
+    for (end=0, iter=0; size>1 && !end; size--)
+    {
+        a = SORT_READ (ctx, 0);
+
+        for (end=1, u=0; u+1<size; u++, iter++)
+        {
+            b = SORT_READ (ctx, u+1);
+
+            if (SORT_LESS (ctx,b,a))
+            {
+                SORT_WRITE (ctx, u, b);
+                SORT_WRITE (ctx, u+1, a);
+                end = 0;
+            }
+            else
+                a = b;
+        }
+    }
+
+    return iter;
+}
+
+// Sorting by the insertion method
+//     Stable:                yes
+//     Max complexity:        O(N*N)
+//     Average complexity:    O(N*N)
+//     Min complexity:        O(N)
+//     Other considerations:  As simple as the bubble, in
+//                            principle, but can be optimized
+//                            to be faster. It will always be
+//                            O(N*N) worst case, though.
+
+static unsigned SORT_NAME(insertion_sort_r) (SORT_CTX ctx,
+                                             unsigned from, unsigned size);
+
+static unsigned SORT_NAME(insertion_sort) (SORT_CTX ctx, unsigned size)
+{
+    return SORT_NAME(insertion_sort_r) (ctx, 0, size);
+}
+
+// (Sorts the size elements from position from)
+
+static unsigned SORT_NAME(insertion_sort_r) (SORT_CTX ctx,
+                                             unsigned from, unsigned size)
+{
+    unsigned u, v, iter;
+    thing a, b, c;
+
+    a = SORT_READ (ctx, from);
+
+    for (u=1, iter=0; u<size; u++)
+    {
+        b = SORT_READ (ctx, from+u);
+
+        if (SORT_LESS (ctx,b,a))
+        {
+            v = u;
+            c = a;
+
+            do
+            {
+                SORT_WRITE (ctx, from+v, c);
+                iter ++;
+
+                if (--v==0)
+                    break;
+
+                c = SORT_READ (ctx, from+v-1);
+            }
+            while (SORT_LESS (ctx,b,c));
+
+            SORT_WRITE (ctx, from+v, b);
+        }
+        else
+        {
+            a = b;
+            iter ++;
+        }
+    }
+
+    return iter;
+}
+
+// Sorting by the selection method
+//     Stable:                no
+//     Max complexity:        O(N*N)
+//     Average complexity:    O(N*N)
+//     Min complexity:        O(N*N)
+//     Other considerations:  Never makes more than 2*N write
+//                            operations. Always makes the same
+//                            number of operations on the array
+//                            (except when it saves write ops.).
+//                            The read operations and one half of
+//                            the write ops. follow a fixed memory
+//                            access pattern. Not so with the
+//                            other half of write ops., though.
+
+static unsigned SORT_NAME(selection_sort) (SORT_CTX ctx, unsigned size)
+{
+    unsigned u, v, min, iter;
+    thing a, b, c;
+
+    for (u=iter=0; u<size-1; u++)
+    {
+        a = b = SORT_READ (ctx, min=u);
+
+        for (v=u+1; v<size; v++, iter++)
+        {
+            c = SORT_READ (ctx, v);
+
+            if (SORT_LESS (ctx,c,b))
+            {
+                min = v;
+                b = c;
+            }
+        }
+
+        if (min!=u)
+        {
+            SORT_WRITE (ctx, u, b);
+            SORT_WRITE (ctx, min, a);
+        }
+    }
+
+    return iter;
+}
+
+// Sorting by the heap method
+//     Stable:                no
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  It's relatively slow compared to the
+//                            _average_ behaviour of quicksort, and
+//                            it is equally slow when the data are
+//                            already sorted or nearly sorted. On
+//                            the other hand, it's the only method
+//                            that, with only O(1) additional
+//                            space, has a worst case time
+//                            complexity of O(N*log N).
+
+static unsigned SORT_NAME(heap_sort_r) (SORT_CTX ctx,
+                                        unsigned from, unsigned size);
+static unsigned SORT_NAME(sift_in) (SORT_CTX ctx, unsigned from,
+                                    unsigned size, unsigned hole,
+                                    thing a);
+
+static unsigned SORT_NAME(heap_sort) (SORT_CTX ctx, unsigned size)
+{
+    return SORT_NAME(heap_sort_r) (ctx, 0, size);
+}
+
+// (Sorts the size elements from position from)
+
+static unsigned SORT_NAME(heap_sort_r) (SORT_CTX ctx,
+                                        unsigned from, unsigned size)
+{
+    unsigned pos, iter;
+    thing a;
+
+    if (size<2)
+        return 0;
+
+    // First: heap up
+
+    for (pos=size>>1, iter=0; pos; pos--)
+        iter += SORT_NAME(sift_in) (ctx, from, size, pos,
+                                    SORT_READ (ctx, from+pos-1));
+
+    // Second: sort while extracting from the heap
+
+    while (size>1)
+    {
+        a = SORT_READ (ctx, from+size-1);
+        SORT_WRITE (ctx, from+size-1, SORT_READ (ctx, from));
+        size --;
+        iter += SORT_NAME(sift_in) (ctx, from, size, 1, a);
+    }
+
+    return iter;
+}
+
+static unsigned SORT_NAME(sift_in) (SORT_CTX ctx, unsigned from,
+                                    unsigned size, unsigned hole,
+                                    thing nuevo)
+{
+    unsigned u, h, iter;
+    thing a, b;
+
+    h = hole;
+    iter = 0;
+
+    for (u=h<<1; u<size; u<<=1, iter++)
+    {
+        a = SORT_READ (ctx, from+u-1);
+        b = SORT_READ (ctx, from+u);
+
+        if (SORT_LESS (ctx,a,b))
+        {
+            u ++;
+            a = b;
+        }
+
+        SORT_WRITE (ctx, from+h-1, a);
+        h = u;
+    }
+
+    if (u==size)
+    {
+        SORT_WRITE (ctx, from+h-1, SORT_READ (ctx, from+u-1));
+        h = u;
+    }
+
+    while ((u=h>>1) >= hole)
+    {
+        a = SORT_READ (ctx, from+u-1);
+        iter ++;
+
+        if (!SORT_LESS (ctx,a,nuevo))
+            break;
+
+        SORT_WRITE (ctx, from+h-1, a);
+        h = u;
+    }
+
+    SORT_WRITE (ctx, from+h-1, nuevo);
+
+    return iter;
+}
+
+// Sorting by the "comb" method
+//     Stable:                no
+//     Max complexity:        O(N*N) (it might be O(N*log N),
+//                                    but it's not proved)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  Fixed memory access pattern
+//                            (if it is O(N*log N))
+
+static unsigned SORT_NAME(comb_sort) (SORT_CTX ctx, unsigned size)
+{
+    unsigned u, v, n, comb, iter;
+    thing a, b;
+
+    iter = n = 0;
+
+    while (size>combs[n])
+        n ++;
+
+    while (n>0)
+    {
+        comb = combs[--n];
+
+        for (u=0, v=comb; v<size; u++, v++, iter++)
+        {
+            a = SORT_READ (ctx, u);
+            b = SORT_READ (ctx, v);
+
+            if (SORT_LESS (ctx,b,a))
+            {
+                SORT_WRITE (ctx, u, b);
+                SORT_WRITE (ctx, v, a);
+            }
+        }
+
+        if (n==0)
+            break;
+
+        comb = combs[--n];
+
+        for (u=size-comb-1, v=size-1; v>=comb; u--, v--, iter++)
+        {
+            a = SORT_READ (ctx, u);
+            b = SORT_READ (ctx, v);
+
+            if (SORT_LESS (ctx,b,a))
+            {
+                SORT_WRITE (ctx, u, b);
+                SORT_WRITE (ctx, v, a);
+            }
+        }
+    }
+
+    return iter + SORT_NAME(insertion_sort) (ctx, size);
+}
+
+// Sorting by the method of merging sorted lists
+//     Stable:                yes
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  It needs O(N) additional memory.
+//                            One version (natural mergesort) is
+//                            O(N) min, but that version makes a
+//                            less efficient use of the cache in
+//                            the average case.
+
+static unsigned SORT_NAME(merge_sort_r) (SORT_CTX ctx, unsigned size,
+                                         unsigned dest, unsigned temp);
+static unsigned SORT_NAME(merge) (SORT_CTX ctx, unsigned from,
+                                  unsigned left, unsigned right,
+                                  unsigned dest);
+
+static unsigned SORT_NAME(merge_sort) (SORT_CTX ctx, unsigned size)
+{
+    unsigned u;
+
+    for (u=0; u<size; u++)
+        SORT_WRITE (ctx, u+size, SORT_READ (ctx, u));
+
+    return size + SORT_NAME(merge_sort_r) (ctx, size, 0, size);
+}
+
+static unsigned SORT_NAME(merge_sort_r) (SORT_CTX ctx, unsigned size,
+                                         unsigned dest, unsigned temp)
+{
+    unsigned left, right, iter;
+
+    left = size / 2;
+    right = size - left;
+    iter = 0;
+
+    if (left>1)
+        iter += SORT_NAME(merge_sort_r) (ctx, left, temp, dest);
+
+    if (right>1)
+        iter += SORT_NAME(merge_sort_r) (ctx, right, temp+left, dest+left);
+
+    return iter + SORT_NAME(merge) (ctx, temp, left, right, dest);
+}
+
+// (Merges the sorted lists of left and right elements from
+// position from into the ones from position dest)
+
+static unsigned SORT_NAME(merge) (SORT_CTX ctx, unsigned from,
+                                  unsigned left, unsigned right,
+                                  unsigned dest)
+{
+    unsigned u, v, w, iter;
+    thing a, b;
+
+    if (left)
+        a = SORT_READ (ctx, from);
+
+    if (right)
+        b = SORT_READ (ctx, from+left);
+
+    for (u=v=w=iter=0; u<left && v<right; w++, iter++)
+        if (SORT_LESS (ctx,b,a))
+        {
+            SORT_WRITE (ctx, dest+w, b);
+
+            if (++v<right)
+                b = SORT_READ (ctx, from+left+v);
+        }
+        else
+        {
+            SORT_WRITE (ctx, dest+w, a);
+
+            if (++u<left)
+                a = SORT_READ (ctx, from+u);
+        }
+
+    if (u<left)
+        for (;;)
+        {
+            iter ++;
+            SORT_WRITE (ctx, dest+w++, a);
+
+            if (++u==left)
+                return iter;
+
+            a = SORT_READ (ctx, from+u);
+        }
+
+    if (v<right)
+        for (;;)
+        {
+            iter ++;
+            SORT_WRITE (ctx, dest+w++, b);
+
+            if (++v==right)
+                return iter;
+
+            b = SORT_READ (ctx, from+left+v);
+        }
+
+    return iter;
+}
+
+// Sorting by the "quick" method
+//     Stable:                no
+//     Max complexity:        O(N*N)      <<-- (that's bad)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  It's the most popular. The problem of
+//                            its O(N*N) worst case complexity is
+//                            solved by switching to heapsort when
+//                            things get ugly. It's also usual to
+//                            switch to insertionsort when the
+//                            number of elements is small (lesser
+//                            than 8, for example)
+
+static unsigned SORT_NAME(quick_sort_r) (SORT_CTX ctx,
+                                         unsigned from, unsigned size,
+                                         unsigned pa);
+static unsigned SORT_NAME(partition) (SORT_CTX ctx,
+                                      unsigned from, unsigned size,
+                                      thing pivot);
+
+static unsigned SORT_NAME(quick_sort) (SORT_CTX ctx, unsigned size)
+{
+    return SORT_NAME(quick_sort_r) (ctx, 0, size, 0);
+}
+
+static unsigned SORT_NAME(quick_sort_pa) (SORT_CTX ctx, unsigned size)
+{
+    return SORT_NAME(quick_sort_r) (ctx, 0, size, 1);
+}
+
+static unsigned SORT_NAME(quick_sort_r) (SORT_CTX ctx,
+                                         unsigned from, unsigned size,
+                                         unsigned pa)
+{
+    unsigned left, right, hole, iter;
+    thing pivot;
+
+    for (iter=0; size>1; )
+    {
+        iter += size;
+
+        if (pa)  // If requested, choose the pivot at random
+        {
+            hole = my_random (from, size);
+            pivot = SORT_READ (ctx, hole);
+            SORT_WRITE (ctx, hole, SORT_READ (ctx, from));
+            iter ++;
+        }
+        else                           // Otherwise, choose the
+            pivot = SORT_READ (ctx, from);   // first one as pivot
+
+        hole = SORT_NAME(partition) (ctx, from, size, pivot);
+
+        left = hole - from;
+        right = from + size - hole - 1;
+
+        if (left>right)
+        {
+            if (right>1)
+                iter += SORT_NAME(quick_sort_r) (ctx, hole+1, right, pa);
+            size = left;
+        }
+        else
+        {
+            if (left>1)
+                iter += SORT_NAME(quick_sort_r) (ctx, from, left, pa);
+            size = right;
+            from = hole + 1;
+        }
+    }
+
+    return iter;
+}
+
+// (Moves the size elements from position from, the first of
+// which has already been read as the pivot, to each side of the
+// position it returns, where it leaves the pivot)
+
+static unsigned SORT_NAME(partition) (SORT_CTX ctx,
+                                      unsigned from, unsigned size,
+                                      thing pivot)
+{
+    unsigned left, right, hole;
+    thing a;
+
+    hole = from;
+    left = from + 1;
+    right = from + size - 1;
+
+    for (;;)
+    {
+        do
+            a = SORT_READ (ctx, right);
+        while (SORT_LESS (ctx,pivot,a) && right-->left);
+
+        if (right<left)
+            break;
+
+        SORT_WRITE (ctx, hole, a);
+        hole = right--;
+
+        do
+            a = SORT_READ (ctx, left);
+        while (SORT_LESS (ctx,a,pivot) && left++<right);
+
+        if (left>right)
+            break;
+
+        SORT_WRITE (ctx, hole, a);
+        hole = left++;
+    }
+
+    SORT_WRITE (ctx, hole, pivot);
+
+    return hole;
+}
+
+// Sorting by the method of merging sorted lists, bottom-up
+// and in tiles
+//     Stable:                yes
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  It needs O(N) additional memory, as
+//                            mergesort does, but instead of
+//                            copying the array first and
+//                            descending to lists of one element,
+//                            it sorts runs of SORT_RUN elements
+//                            in place (with the insertion method)
+//                            and then merges them by passes, each
+//                            of them going once through both
+//                            halves of the space in order.
+
+static unsigned SORT_NAME(merge_sort_bu) (SORT_CTX ctx, unsigned size)
+{
+    unsigned u, from, run, left, right, src, dst, iter;
+
+    // First: sort the runs in place
+
+    for (from=iter=0; from<size; from+=SORT_RUN)
+        iter += SORT_NAME(insertion_sort_r) (ctx, from,
+                            size-from<SORT_RUN ? size-from : SORT_RUN);
+
+    // Second: merge pairs of runs from one half of the space
+    // into the other
+
+    for (src=0, dst=size, run=SORT_RUN; run<size;
+         run*=2, u=src, src=dst, dst=u)
+        for (from=0; from<size; from+=2*run)
+        {
+            left = size-from<run ? size-from : run;
+            right = size-from-left<run ? size-from-left : run;
+            iter += SORT_NAME(merge) (ctx, src+from, left, right,
+                                      dst+from);
+        }
+
+    // Third: if the last pass left them in the second half,
+    // bring them back
+
+    if (src)
+        for (u=0; u<size; u++, iter++)
+            SORT_WRITE (ctx, u, SORT_READ (ctx, src+u));
+
+    return iter;
+}
+
+// Introspective sorting (introsort, Musser)
+//     Stable:                no
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  The quicksort of production
+//                            libraries: the pivot is the median
+//                            of the first, middle and last
+//                            elements, partitions of SORT_RUN
+//                            elements or less are left as they
+//                            are, to be finished by one insertion
+//                            pass over the whole array, and
+//                            partitions that go too deep (more
+//                            than 2*log2 N levels) are sorted
+//                            with heapsort.
+
+static unsigned SORT_NAME(intro_sort_r) (SORT_CTX ctx,
+                                         unsigned from, unsigned size,
+                                         unsigned depth);
+
+static unsigned SORT_NAME(intro_sort) (SORT_CTX ctx, unsigned size)
+{
+    unsigned n, depth;
+
+    for (n=size, depth=0; n>1; n>>=1)
+        depth += 2;
+
+    return SORT_NAME(intro_sort_r) (ctx, 0, size, depth) +
+           SORT_NAME(insertion_sort_r) (ctx, 0, size);
+}
+
+static unsigned SORT_NAME(intro_sort_r) (SORT_CTX ctx,
+                                         unsigned from, unsigned size,
+                                         unsigned depth)
+{
+    unsigned left, right, mid, last, hole, iter;
+    thing a, b, c, pivot;
+
+    for (iter=0; size>SORT_RUN; depth--)
+    {
+        if (depth==0)
+            return iter + SORT_NAME(heap_sort_r) (ctx, from, size);
+
+        iter += size;
+
+        // Median of three as pivot, leaving the first element
+        // in its place
+
+        mid = from + size/2;
+        last = from + size - 1;
+
+        a = SORT_READ (ctx, from);
+        b = SORT_READ (ctx, mid);
+        c = SORT_READ (ctx, last);
+
+        if (SORT_LESS (ctx,a,b))
+            hole = SORT_LESS (ctx,b,c) ? mid :
+                   SORT_LESS (ctx,a,c) ? last : from;
+        else
+            hole = SORT_LESS (ctx,a,c) ? from :
+                   SORT_LESS (ctx,b,c) ? last : mid;
+
+        if (hole==from)
+            pivot = a;
+        else
+        {
+            pivot = hole==mid ? b : c;
+            SORT_WRITE (ctx, hole, a);
+        }
+
+        hole = SORT_NAME(partition) (ctx, from, size, pivot);
+
+        left = hole - from;
+        right = from + size - hole - 1;
+
+        if (left>right)
+        {
+            iter += SORT_NAME(intro_sort_r) (ctx, hole+1, right, depth-1);
+            size = left;
+        }
+        else
+        {
+            iter += SORT_NAME(intro_sort_r) (ctx, from, left, depth-1);
+            size = right;
+            from = hole + 1;
+        }
+    }
+
+    return iter;
+}
+
+// Sorting by the radix method (least significant digit first)
+//     Stable:                yes
+//     Max complexity:        O(N)
+//     Average complexity:    O(N)
+//     Min complexity:        O(N)
+//     Other considerations:  It makes no comparisons: the keys
+//                            (see sort_key) are distributed by
+//                            their bytes, from the lowest one, in
+//                            one pass per byte from one half of
+//                            the space (O(N) additional memory)
+//                            to the other. The bytes are counted
+//                            all at once in a first pass, and the
+//                            passes of the bytes that every key
+//                            has the same are left out. Each pass
+//                            reads in order, but writes to 256
+//                            places of the array at once.
+
+static unsigned SORT_NAME(radix_sort) (SORT_CTX ctx, unsigned size)
+{
+    unsigned count[sizeof(thing)][256];
+    unsigned u, d, sum, n, src, dst, iter;
+    unsigned long long k, first = 0;
+    thing a;
+
+    if (size<2)
+        return 0;
+
+    // First: count every byte of the keys
+
+    memset (count, 0, sizeof(count));
+
+    for (u=0; u<size; u++)
+    {
+        k = sort_key (SORT_READ (ctx, u));
+
+        if (u==0)
+            first = k;
+
+        for (d=0; d<sizeof(thing); d++, k>>=8)
+            count[d][k&255] ++;
+    }
+
+    // Second: one pass for every byte that makes a difference
+    // (any key, the first one, shows whether all of them have
+    // the same one)
+
+    for (d=0, src=0, dst=size, iter=size; d<sizeof(thing); d++)
+    {
+        if (count[d][(first>>8*d)&255] == size)
+            continue;
+
+        for (u=sum=0; u<256; u++)
+        {
+            n = count[d][u];
+            count[d][u] = sum;
+            sum += n;
+        }
+
+        for (u=0; u<size; u++, iter++)
+        {
+            a = SORT_READ (ctx, src+u);
+            SORT_WRITE (ctx, dst + count[d][(sort_key (a)>>8*d)&255]++,
+                        a);
+        }
+
+        u = src;
+        src = dst;
+        dst = u;
+    }
+
+    // Third: if the last pass left them in the second half,
+    // bring them back
+
+    if (src)
+        for (u=0; u<size; u++, iter++)
+            SORT_WRITE (ctx, u, SORT_READ (ctx, src+u));
+
+    return iter;
+}
+
+// Sorting by the method of merging sorted lists, in place
+//     Stable:                yes
+//     Max complexity:        O(N*log N*log N)
+//     Average complexity:    O(N*log N*log N)
+//     Min complexity:        O(N) (if already sorted)
+//     Other considerations:  It needs no additional memory.
+//                            Runs of SORT_RUN elements are sorted
+//                            with the insertion method, and then
+//                            merged by passes, as in the
+//                            bottom-up mergesort, but every merge
+//                            is done in place by the SymMerge
+//                            method (Kim and Kutzner): a binary
+//                            search finds the blocks that must
+//                            trade places around the middle, they
+//                            are rotated, and both halves are
+//                            merged again the same way.
+
+static unsigned SORT_NAME(sym_merge) (SORT_CTX ctx, unsigned lo,
+                                      unsigned m, unsigned hi);
+static unsigned SORT_NAME(rotate) (SORT_CTX ctx, unsigned lo,
+                                   unsigned m, unsigned hi);
+
+static unsigned SORT_NAME(merge_sort_ip) (SORT_CTX ctx, unsigned size)
+{
+    unsigned from, run, iter;
+
+    for (from=iter=0; from<size; from+=SORT_RUN)
+        iter += SORT_NAME(insertion_sort_r) (ctx, from,
+                            size-from<SORT_RUN ? size-from : SORT_RUN);
+
+    for (run=SORT_RUN; run<size; run*=2)
+        for (from=0; from+run<size; from+=2*run)
+            iter += SORT_NAME(sym_merge) (ctx, from, from+run,
+                                          size-from-run<run ? size :
+                                                             from+2*run);
+
+    return iter;
+}
+
+// (Merges the sorted lists of positions [lo,m) and [m,hi))
+
+static unsigned SORT_NAME(sym_merge) (SORT_CTX ctx, unsigned lo,
+                                      unsigned m, unsigned hi)
+{
+    unsigned i, j, h, mid, start, end, r, iter;
+    thing a, b;
+
+    iter = 0;
+
+    // One element on the left: it goes before the first one of
+    // the right not lesser than it, and the others move back
+
+    if (m-lo==1)
+    {
+        a = SORT_READ (ctx, lo);
+
+        for (i=m, j=hi; i<j; iter++)
+        {
+            h = i + (j-i)/2;
+
+            if (SORT_LESS (ctx,SORT_READ (ctx, h),a))
+                i = h + 1;
+            else
+                j = h;
+        }
+
+        if (i>m)
+        {
+            for (h=m; h<i; h++, iter++)
+                SORT_WRITE (ctx, h-1, SORT_READ (ctx, h));
+
+            SORT_WRITE (ctx, i-1, a);
+        }
+
+        return iter;
+    }
+
+    // One element on the right: it goes after the last one of
+    // the left not greater than it, and the others move on
+
+    if (hi-m==1)
+    {
+        a = SORT_READ (ctx, m);
+
+        for (i=lo, j=m; i<j; iter++)
+        {
+            h = i + (j-i)/2;
+
+            if (!SORT_LESS (ctx,a,SORT_READ (ctx, h)))
+                i = h + 1;
+            else
+                j = h;
+        }
+
+        if (i<m)
+        {
+            for (h=m; h>i; h--, iter++)
+                SORT_WRITE (ctx, h, SORT_READ (ctx, h-1));
+
+            SORT_WRITE (ctx, i, a);
+        }
+
+        return iter;
+    }
+
+    // Otherwise, look for the part of the left ([start,m)) and
+    // the part of the right ([m,end)) that are to be exchanged,
+    // symmetrically around mid
+
+    mid = lo + (hi-lo)/2;
+
+    if (m>mid)
+    {
+        start = mid + m - hi;
+        r = mid;
+    }
+    else
+    {
+        start = lo;
+        r = m;
+    }
+
+    while (start<r)
+    {
+        h = start + (r-start)/2;
+        a = SORT_READ (ctx, mid+m-1-h);
+        b = SORT_READ (ctx, h);
+        iter ++;
+
+        if (!SORT_LESS (ctx,a,b))
+            start = h + 1;
+        else
+            r = h;
+    }
+
+    end = mid + m - start;
+
+    if (start<m && m<end)
+        iter += SORT_NAME(rotate) (ctx, start, m, end);
+
+    if (lo<start && start<mid)
+        iter += SORT_NAME(sym_merge) (ctx, lo, start, mid);
+
+    if (mid<end && end<hi)
+        iter += SORT_NAME(sym_merge) (ctx, mid, end, hi);
+
+    return iter;
+}
+
+// (Exchanges the blocks of positions [lo,m) and [m,hi), by
+// reversing each of them and then both together)
+
+static unsigned SORT_NAME(rotate) (SORT_CTX ctx, unsigned lo,
+                                   unsigned m, unsigned hi)
+{
+    unsigned from[3] = { lo, m, lo }, to[3] = { m, hi, hi };
+    unsigned i, j, k, iter;
+    thing a, b;
+
+    for (k=iter=0; k<3; k++)
+        for (i=from[k], j=to[k]-1; i<j; i++, j--, iter++)
+        {
+            a = SORT_READ (ctx, i);
+            b = SORT_READ (ctx, j);
+            SORT_WRITE (ctx, i, b);
+            SORT_WRITE (ctx, j, a);
+        }
+
+    return iter;
+}
+
+#undef SORT_NAME
+#undef SORT_CTX
+#undef SORT_READ
+#undef SORT_WRITE
+#undef SORT_LESS
@@ -0,0 +1,317 @@
+/*
+    trace.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+// Helper functions for the varints of the binary format
+
+static void put_varint (FILE * pf, unsigned long long v)
+{
+    while (v >= 0x80)
+    {
+        putc_unlocked ((int)(v & 0x7F) | 0x80, pf);
+        v >>= 7;
+    }
+
+    putc_unlocked ((int)v, pf);
+}
+
+// Helper functions that take bytes from the buffer (-1 at the
+// end of the file)
+
+static int refill (strace * pT)
+{
+    ssize_t n;
+
+    if (pT->fd < 0)    // A trace in memory has no more bytes
+        return -1;
+
+    do
+        n = read (pT->fd, pT->buf, TRACE_BUF_SIZE);
+    while (n<0 && errno==EINTR);
+
+    pT->head = 0;
+    pT->tail = n>0 ? n : 0;
+
+    return n>0 ? pT->data[pT->head++] : -1;
+}
+
+#define NEXT_BYTE(T) ((T)->head<(T)->tail ? (T)->data[(T)->head++] : \
+                                            refill(T))
+
+static int get_varint (strace * pT, unsigned long long * pv)
+{
+    unsigned long long v;
+    int c, shift;
+
+    for (v=0, shift=0; shift<64; shift+=7)
+    {
+        if ((c=NEXT_BYTE(pT)) < 0)
+            return 0;
+
+        v |= (unsigned long long)(c & 0x7F) << shift;
+
+        if (!(c & 0x80))
+        {
+            *pv = v;
+            return 1;
+        }
+    }
+
+    return 0;  // Too long: corrupted trace
+}
+
+// Helper functions for the text format
+
+static int skip_spaces (strace * pT)
+{
+    int c;
+
+    while ((c=NEXT_BYTE(pT))==' ' || c=='\n' || c=='\t' || c=='\r')
+        ;
+
+    return c;
+}
+
+static int get_number (strace * pT, unsigned * pu)
+{
+    unsigned u;
+    int c, digits;
+
+    for (u=0, digits=0; (c=NEXT_BYTE(pT))>='0' && c<='9'; digits++)
+        u = u*10 + (c-'0');
+
+    if (c>=0)
+        pT->head --;   // Give back the byte after the number
+
+    *pu = u;
+    return digits>0;
+}
+
+// Functions that read a trace
+
+static int read_header (strace * pT, unsigned * ptotalsz)
+{
+    unsigned long long v;
+    int c, u;
+
+    pT->last = 0;
+    c = NEXT_BYTE (pT);
+
+    if (c < 0)
+        return 0;
+
+    if (c != TRACE_MAGIC[0])  // Text trace
+    {
+        pT->head --;
+        pT->binary = 0;
+
+        if (skip_spaces(pT)!='T' || skip_spaces(pT)<0)
+            return 0;
+
+        pT->head --;   // Give back the first digit
+        return get_number (pT, ptotalsz);
+    }
+
+    pT->binary = 1;
+
+    for (u=1; u<TRACE_MAGIC_LEN; u++)
+        if (NEXT_BYTE(pT) != TRACE_MAGIC[u])
+            return 0;
+
+    if (NEXT_BYTE(pT) != TRACE_VERSION)
+    {
+        fprintf (stderr, "ERROR: unsupported trace version\n");
+        return 0;
+    }
+
+    if (!get_varint(pT,&v))
+        return 0;
+
+    *ptotalsz = (unsigned) v;
+    return 1;
+}
+
+int trace_open (strace * pT, int fd, unsigned * ptotalsz)
+{
+    pT->fd = fd;
+    pT->data = pT->buf;
+    pT->head = pT->tail = 0;
+
+    return read_header (pT, ptotalsz);
+}
+
+int trace_open_memory (strace * pT, const void * data, size_t size,
+                       unsigned * ptotalsz)
+{
+    pT->fd = -1;
+    pT->data = (const unsigned char*) data;
+    pT->head = 0;
+    pT->tail = size;
+
+    return read_header (pT, ptotalsz);
+}
+
+int trace_next (strace * pT, char * pop, unsigned * ppos)
+{
+    unsigned long long v;
+    unsigned zz;
+    int c;
+
+    if (!pT->binary)
+    {
+        // Ignore spaces and read one character
+        if ((c=skip_spaces(pT)) < 0)
+            return 0;
+
+        *pop = c;
+
+        // If R/W, take element number
+        if (*pop=='R' || *pop=='W')
+            return get_number (pT, ppos);
+
+        return 1;
+    }
+
+    if (!get_varint(pT,&v))
+        return 0;
+
+    switch (v & 3)
+    {
+        case TRACE_OP_READ:
+        case TRACE_OP_WRITE:
+            zz = (unsigned)(v >> 2);
+            pT->last += (zz >> 1) ^ -(zz & 1);  // Undo zigzag
+            *ppos = pT->last;
+            *pop = (v & 3)==TRACE_OP_READ ? 'R' : 'W';
+            break;
+
+        case TRACE_OP_COMP:
+            *pop = 'C';
+            break;
+
+        default:
+            *pop = (v >> 2) ? 'O' : 'S';
+    }
+
+    return 1;
+}
+
+int trace_next_batch (strace * pT, unsigned * refs, int max, char * pend)
+{
+    int n;
+    char op;
+    unsigned u;
+
+    const unsigned char * data;
+    size_t head, tail;
+    unsigned last, zz;
+    unsigned long long v;
+    int c, shift;
+
+    *pend = 0;
+
+    for (n=0; n<max; )
+    {
+        // Fast path: binary records entirely in the buffer. The
+        // state is kept in locals while decoding, as the stores
+        // to refs could alias it.
+        if (pT->binary && pT->tail-pT->head >= 10)
+        {
+            data = pT->data;
+            head = pT->head;
+            tail = pT->tail;
+            last = pT->last;
+
+            for (; n<max && tail-head >= 10; n++)
+            {
+                c = data[head++];
+                v = c & 0x7F;
+
+                for (shift=7; (c & 0x80) && shift<64; shift+=7)
+                {
+                    c = data[head++];
+                    v |= (unsigned long long)(c & 0x7F) << shift;
+                }
+
+                if ((v & 3) == TRACE_OP_READ || (v & 3) == TRACE_OP_WRITE)
+                {
+                    zz = (unsigned)(v >> 2);
+                    last += (zz >> 1) ^ -(zz & 1);  // Undo zigzag
+                    refs[n] = last<<2 | (v & 3);
+                }
+                else if ((v & 3) == TRACE_OP_COMP)
+                    refs[n] = TRACE_OP_COMP;
+                else
+                {
+                    *pend = (v >> 2) ? 'O' : 'S';
+                    break;
+                }
+            }
+
+            pT->head = head;
+            pT->last = last;
+
+            if (*pend)
+                break;
+
+            continue;
+        }
+
+        if (!trace_next(pT,&op,&u))
+            return -1;
+
+        if (op=='R' || op=='W')
+            refs[n++] = TRACE_REF (op, u);
+        else if (op=='C')
+            refs[n++] = TRACE_REF (op, 0);
+        else if (op=='S' || op=='O')
+        {
+            *pend = op;
+            break;
+        }
+        else
+            return -1;
+    }
+
+    return n;
+}
+
+// Functions that write a binary trace
+
+void trace_put_header (FILE * pf, unsigned totalsz)
+{
+    fwrite (TRACE_MAGIC, 1, TRACE_MAGIC_LEN, pf);
+    putc (TRACE_VERSION, pf);
+    put_varint (pf, totalsz);
+}
+
+void trace_put_op (FILE * pf, unsigned * plast, char op, unsigned pos)
+{
+    int delta;
+    unsigned zz;
+
+    if (op == 'C')
+    {
+        put_varint (pf, TRACE_OP_COMP);
+        return;
+    }
+
+    delta = (int)(pos - *plast);
+    zz = ((unsigned)delta << 1) ^ (unsigned)(delta >> 31);  // Zigzag
+    *plast = pos;
+
+    put_varint (pf, ((unsigned long long)zz << 2) |
+                    (op=='R' ? TRACE_OP_READ : TRACE_OP_WRITE));
+}
+
+void trace_put_end (FILE * pf, int sorted)
+{
+    put_varint (pf, (sorted ? 0 : 4) | TRACE_OP_END);
+}
@@ -0,0 +1,91 @@
+/*
+    trace.h
+*/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>
+
+// gen_trace can write its traces in two formats:
+//
+//   Text (TXT): " T<totalsz>", then " R<pos>", " W<pos>" and
+//       " C" tokens, and a final "Sorted ;-)" (or "Out of
+//       order :-(") line. Slow, but easy to read by eye.
+//
+//   Binary (BIN): the header TRACE_MAGIC, one byte with
+//       TRACE_VERSION and totalsz as a varint, followed by one
+//       varint per operation. The two lowest bits of each
+//       varint hold the opcode, and the rest hold the
+//       zigzag-encoded difference between the position and
+//       the previous one. Most sorting algorithms access
+//       neighbouring positions, so records take 1 or 2 bytes.
+//
+// Varints store 7 bits per byte, least significant first, and
+// use the high bit of each byte to flag that more follow.
+
+#define TRACE_MAGIC     "\0TRB"  // A '\0' never starts a text trace
+#define TRACE_MAGIC_LEN 4
+#define TRACE_VERSION   1
+
+#define TRACE_OP_READ   0
+#define TRACE_OP_WRITE  1
+#define TRACE_OP_COMP   2
+#define TRACE_OP_END    3        // Payload: 0 sorted, 1 out of order
+
+// Operations decoded in batches: the opcode in the two lowest
+// bits (TRACE_OP_READ, _WRITE or _COMP) and the position in
+// the rest
+
+#define TRACE_REF(OP,POS) ((POS)<<2 | ((OP)=='R' ? TRACE_OP_READ :  \
+                                       (OP)=='W' ? TRACE_OP_WRITE : \
+                                                   TRACE_OP_COMP))
+#define TRACE_REF_POS(R)  ((R)>>2)
+#define TRACE_REF_OP(R)   ("RWC?"[(R)&3])
+
+// State of a trace being read (in either format). The trace
+// is read with read() in large blocks, and decoded by hand
+// from the buffer, or it is decoded straight from memory
+// (e.g., a file mapped with mmap).
+
+#define TRACE_BUF_SIZE 65536
+
+typedef struct
+{
+    int fd;             // File the trace comes from (-1: memory)
+    int binary;         // 1 = binary format, 0 = text
+    unsigned last;      // Last position (binary deltas)
+    const unsigned char * data;  // buf, or the trace in memory
+    size_t head, tail;           // Valid bytes of data
+    unsigned char buf[TRACE_BUF_SIZE];
+}
+strace;
+
+// Functions that read a trace. trace_open detects the format
+// and reads the total size (trace_open_memory does the same
+// with the size bytes at data, which must stay there while the
+// trace is read); trace_next returns 1 and one
+// operation ('R', 'W', 'C', 'S'orted or 'O'ut of order) at
+// a time, with its position in *ppos for 'R' and 'W', or 0
+// at the end of the stream or if the trace is malformed.
+//
+// trace_next_batch decodes up to max operations into refs
+// (see TRACE_REF) and returns how many, stopping early at the
+// end of the trace, when it puts 'S' or 'O' in *pend (0 if the
+// trace goes on). Returns -1 if the trace is malformed or
+// ends without 'S' or 'O'.
+
+int trace_open (strace *, int fd, unsigned * ptotalsz);
+int trace_open_memory (strace *, const void * data, size_t size,
+                       unsigned * ptotalsz);
+int trace_next (strace *, char * pop, unsigned * ppos);
+int trace_next_batch (strace *, unsigned * refs, int max, char * pend);
+
+// Functions that write a binary trace (*plast keeps the last
+// position written, and must start at 0)
+
+void trace_put_header (FILE *, unsigned totalsz);
+void trace_put_op (FILE *, unsigned * plast, char op, unsigned pos);
+void trace_put_end (FILE *, int sorted);
+
+#endif // _TRACE_H_
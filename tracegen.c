@@ -0,0 +1,911 @@
+/*
+    tracegen.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tracegen.h"
+
+// Functions that the sorting algorithms should use in order
+// to access the data of the array:
+
+static thing read_thing (void * p, unsigned pos)
+{
+    scontrol * pc = (scontrol*) p;
+
+    pc->nreads ++;
+
+    if (pc->psink)
+        pc->psink (pc->pctx, 'R', pos);
+
+    return pc->pdata[pos];
+}
+
+static void write_thing (void * p, unsigned pos, thing value)
+{
+    scontrol * pc = (scontrol*) p;
+
+    pc->nwrites ++;
+
+    if (pc->psink)
+        pc->psink (pc->pctx, 'W', pos);
+
+    pc->pdata[pos] = value;
+}
+
+// Functions that the sorting algorithms should use in order
+// to compare values of the array:
+
+int lesser_than (void * p, thing a, thing b)
+{
+    scontrol * pc = (scontrol*) p;
+
+    pc->ncomparisons ++;
+
+    if (pc->psink)
+        pc->psink (pc->pctx, 'C', 0);
+
+    return a < b;
+}
+
+int lesser_than_back_to_front (void * p, thing a, thing b)
+{
+    scontrol * pc = (scontrol*) p;
+
+    pc->ncomparisons ++;
+
+    if (pc->psink)
+        pc->psink (pc->pctx, 'C', 0);
+
+    return a > b;
+}
+
+// Versions of the sorting algorithms specialized for each
+// kind of sink (see sort_impl.h), with the accesses inlined:
+// counting_* only count the operations, buffered_* also put
+// them (as in TRACE_REF) in a buffer that is handed to a
+// function_batch_sink when full, and plain_* do not even count
+// them. All of them compare as lesser_than.
+
+#define BATCH_SIZE 4096   // Operations handed at once
+
+typedef struct
+{
+    thing * pdata;
+    unsigned long long nreads, nwrites, ncomparisons;
+    function_batch_sink * pbatch;   // Receives the operations
+    void * pctx;                    // First parameter of pbatch
+    unsigned numrefs;               // Operations in refs
+    unsigned refs[BATCH_SIZE];
+}
+sbuffered;
+
+static inline thing counting_read (scontrol * pc, unsigned pos)
+{
+    pc->nreads ++;
+    return pc->pdata[pos];
+}
+
+static inline void counting_write (scontrol * pc, unsigned pos,
+                                   thing value)
+{
+    pc->nwrites ++;
+    pc->pdata[pos] = value;
+}
+
+static inline int counting_lesser (scontrol * pc, thing a, thing b)
+{
+    pc->ncomparisons ++;
+    return a < b;
+}
+
+#define SORT_NAME(x) counting_##x
+#define SORT_CTX scontrol *
+#define SORT_READ(c,pos) counting_read (c, pos)
+#define SORT_WRITE(c,pos,v) counting_write (c, pos, v)
+#define SORT_LESS(c,a,b) counting_lesser (c, a, b)
+
+#include "sort_impl.h"
+
+static inline void buffered_put (sbuffered * pb, unsigned ref)
+{
+    pb->refs[pb->numrefs++] = ref;
+
+    if (pb->numrefs==BATCH_SIZE)
+    {
+        pb->pbatch (pb->pctx, pb->refs, BATCH_SIZE);
+        pb->numrefs = 0;
+    }
+}
+
+// (The value to be written is read before the write is put)
+
+static inline thing buffered_read (sbuffered * pb, unsigned pos)
+{
+    pb->nreads ++;
+    buffered_put (pb, TRACE_REF('R',pos));
+    return pb->pdata[pos];
+}
+
+static inline void buffered_write (sbuffered * pb, unsigned pos,
+                                   thing value)
+{
+    pb->nwrites ++;
+    buffered_put (pb, TRACE_REF('W',pos));
+    pb->pdata[pos] = value;
+}
+
+static inline int buffered_lesser (sbuffered * pb, thing a, thing b)
+{
+    pb->ncomparisons ++;
+    buffered_put (pb, TRACE_REF('C',0));
+    return a < b;
+}
+
+#define SORT_NAME(x) buffered_##x
+#define SORT_CTX sbuffered *
+#define SORT_READ(c,pos) buffered_read (c, pos)
+#define SORT_WRITE(c,pos,v) buffered_write (c, pos, v)
+#define SORT_LESS(c,a,b) buffered_lesser (c, a, b)
+
+#include "sort_impl.h"
+
+#define SORT_NAME(x) plain_##x
+#define SORT_CTX thing *
+#define SORT_READ(c,pos) ((c)[pos])
+#define SORT_WRITE(c,pos,v) ((c)[pos] = (v))
+#define SORT_LESS(c,a,b) ((a) < (b))
+
+#include "sort_impl.h"
+
+// Sink of the generic algorithms when the operations are taken
+// in batches (for sorts not in the table of find_sort)
+
+static void buffered_op (void * p, char op, unsigned pos)
+{
+    buffered_put ((sbuffered*) p, TRACE_REF(op,pos));
+}
+
+// Functions that prepare the data according to
+// different criteria:
+
+// The fills go through int (size is at most MAX_SIZE), which,
+// unlike unsigned, converts to thing with vector instructions
+
+void ascending_order (thing A[], unsigned size)
+{
+    int i;
+
+    for (i=0; i<(int)size; i++)
+        A[i] = i;
+}
+
+void descending_order (thing A[], unsigned size)
+{
+    int i, last = size-1;
+
+    for (i=0; i<(int)size; i++)
+        A[i] = last-i;
+}
+
+void random_order (thing A[], unsigned size)
+{
+    unsigned u, n;
+    thing tmp;
+
+    srand (0);
+
+    for (u=0; u<5; u++)
+        rand ();
+
+    ascending_order (A, size);
+
+    for (u=0; u<size-1; u++)
+    {
+        n = 1 + u + (unsigned)(rand() * (size-u-1.0) / RAND_MAX);
+
+        if (n>size-1)
+            n = size-1;
+
+        if (n!=u)
+        {
+            tmp = A[n];
+            A[n] = A[u];
+            A[u] = tmp;
+        }
+    }
+}
+
+// A random order that does not come from rand(): element u
+// gets the image of u by a pseudo-random permutation of
+// 0..size-1, a Feistel network of SHUFFLE_ROUNDS rounds on
+// the 2h bits of the smallest power of 4 not below size, and
+// images of size or more are sent through it again (cycle
+// walking) until they fall below size. The keys of the rounds
+// come from splitmix64, a counter-based generator, and the
+// function of a round is a multiplicative hash (one multiply),
+// so each element depends only on its position: there is no
+// rand() state nor any swap, and any part of the array can be
+// filled apart from the rest.
+
+#define SHUFFLE_SEED 0x9e3779b97f4a7c15ULL
+#define SHUFFLE_ROUNDS 4
+
+static uint64_t splitmix64 (uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x>>30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x>>27)) * 0x94d049bb133111ebULL;
+
+    return x ^ (x>>31);
+}
+
+void shuffled_order (thing A[], unsigned size)
+{
+    uint64_t key[SHUFFLE_ROUNDS];
+    unsigned u, v, l, r, tmp, mask;
+    int h, k;
+
+    for (h=1; (1ULL<<2*h) < size; h++)
+        ;
+
+    mask = (1U<<h)-1;   // The low half
+
+    for (k=0; k<SHUFFLE_ROUNDS; k++)
+        key[k] = splitmix64 (SHUFFLE_SEED+k);
+
+    for (u=0; u<size; u++)
+    {
+        v = u;
+
+        do
+        {
+            l = v>>h;
+            r = v & mask;
+
+            for (k=0; k<SHUFFLE_ROUNDS; k++)
+            {
+                tmp = r;
+                r = l ^ (unsigned)(((key[k]+r) *
+                                    0x9e3779b97f4a7c15ULL) >> (64-h));
+                l = tmp;
+            }
+
+            v = l<<h | r;
+        }
+        while (v >= size);
+
+        A[u] = v;
+    }
+}
+
+// Functions that look for an algorithm or an initial state
+// by its name in the command line
+
+static const struct
+{
+    function_prepare_data * pfun;
+    const char * name;
+}
+G[] = { { ascending_order, "ASC" },
+        { descending_order, "DES" },
+        { random_order, "RAN" },
+        { shuffled_order, "SHU" },
+        { NULL, NULL } };
+
+// (With the space they need, in times the size of the array,
+// and the specialized versions of every algorithm)
+
+#define ALGORITHM(f,name,space) { f, name, space, counting_##f, \
+                                  buffered_##f, plain_##f }
+
+static const struct
+{
+    function_sort * pfun;
+    const char * name;
+    unsigned space;
+    unsigned (*pcounting) (scontrol *, unsigned);
+    unsigned (*pbuffered) (sbuffered *, unsigned);
+    unsigned (*pplain) (thing *, unsigned);
+}
+S[] = { ALGORITHM (bubble_sort, "BUB", 1),
+        ALGORITHM (insertion_sort, "INS", 1),
+        ALGORITHM (selection_sort, "SEL", 1),
+        ALGORITHM (heap_sort, "HEA", 1),
+        ALGORITHM (comb_sort, "COM", 1),
+        ALGORITHM (merge_sort, "MER", 2),
+        ALGORITHM (quick_sort, "QUI", 1),
+        ALGORITHM (quick_sort_pa, "QRP", 1),
+        ALGORITHM (merge_sort_bu, "BMS", 2),
+        ALGORITHM (intro_sort, "INT", 1),
+        ALGORITHM (radix_sort, "RAD", 2),
+        ALGORITHM (merge_sort_ip, "IMS", 1),
+        { NULL, NULL, 0, NULL, NULL, NULL } };
+
+function_sort * find_sort (const char * name)
+{
+    unsigned u;
+
+    for (u=0; S[u].pfun; u++)
+        if (!strcmp(name,S[u].name))
+            break;
+
+    return S[u].pfun;
+}
+
+function_prepare_data * find_prepare (const char * name)
+{
+    unsigned u;
+
+    for (u=0; G[u].pfun; u++)
+        if (!strcmp(name,G[u].name))
+            break;
+
+    return G[u].pfun;
+}
+
+unsigned total_size (function_sort * psort, unsigned size)
+{
+    unsigned u;
+
+    for (u=0; S[u].pfun; u++)
+        if (S[u].pfun==psort)
+            return S[u].space*size;
+
+    return size;
+}
+
+// Functions that reserve and free the array: with malloc, or
+// mapped from an unlinked temporary file if it is huge
+
+static thing * alloc_things (size_t n)
+{
+    char name[256];
+    const char * dir;
+    thing * A;
+    int fd;
+
+    if (n*sizeof(thing) < MMAP_THRESHOLD)
+        return (thing*) malloc (n*sizeof(thing));
+
+    dir = getenv ("TMPDIR");
+    snprintf (name, sizeof(name), "%s/tracegen-XXXXXX",
+                                  dir && *dir ? dir : "/tmp");
+
+    if ((fd=mkstemp(name)) < 0)
+        return NULL;
+
+    unlink (name);   // Disappears with the mapping
+
+    if (ftruncate(fd,n*sizeof(thing)) < 0)
+        A = MAP_FAILED;
+    else
+        A = (thing*) mmap (NULL, n*sizeof(thing),
+                           PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close (fd);
+
+    return A==MAP_FAILED ? NULL : A;
+}
+
+static void free_things (thing * A, size_t n)
+{
+    if (n*sizeof(thing) < MMAP_THRESHOLD)
+        free (A);
+    else
+        munmap (A, n*sizeof(thing));
+}
+
+// Function that prepares and sorts the array, with the
+// version of the algorithm that suits the sink: the generic
+// one if there is a psink, the buffered one if there is a
+// pbatch, and otherwise the counting one, or the plain one if
+// there is not even a pc
+
+static int generate (function_sort * psort,
+                     function_prepare_data * pprepare,
+                     unsigned size,
+                     function_sink * psink,
+                     function_batch_sink * pbatch, void * pctx,
+                     scontrol * pc)
+{
+    thing * A;         // Dynamic array with data to sort
+    scontrol C;        // If there is no pc
+    sbuffered * pb;
+    unsigned u, k;
+
+    if (size > MAX_SIZE)
+        return -1;
+
+    for (k=0; S[k].pfun && S[k].pfun!=psort; k++)
+        ;
+
+    pb = NULL;
+
+    if (pbatch && !(pb = (sbuffered*) malloc (sizeof(sbuffered))))
+        return -1;
+
+    A = alloc_things (total_size(psort,size));
+
+    if (!A)
+    {
+        free (pb);
+        return -1;
+    }
+
+    if (!pc)
+        pc = &C;
+
+    pc->pdata = A;
+
+    // Same state of rand() as in a new gen_trace process, so
+    // that traces do not depend on what ran before (quick_sort_pa
+    // takes its pivots from rand())
+    srand (1);
+
+    // Generate data in specified initial state
+    pprepare (A, size);
+
+    // Reset counters
+    pc->nreads = pc->nwrites = pc->ncomparisons = 0;
+    pc->psink = psink;
+    pc->pctx = pctx;
+
+    // Sort data with specified algorithm
+    if (pb)
+    {
+        pb->pdata = A;
+        pb->nreads = pb->nwrites = pb->ncomparisons = 0;
+        pb->pbatch = pbatch;
+        pb->pctx = pctx;
+        pb->numrefs = 0;
+
+        if (S[k].pfun)
+            S[k].pbuffered (pb, size);
+        else
+        {
+            pc->psink = buffered_op;
+            pc->pctx = pb;
+            psort (pc, size, lesser_than, read_thing, write_thing);
+            pb->nreads = pc->nreads;
+            pb->nwrites = pc->nwrites;
+            pb->ncomparisons = pc->ncomparisons;
+        }
+
+        if (pb->numrefs)
+            pbatch (pctx, pb->refs, pb->numrefs);
+
+        pc->nreads = pb->nreads;
+        pc->nwrites = pb->nwrites;
+        pc->ncomparisons = pb->ncomparisons;
+        free (pb);
+    }
+    else if (!psink && S[k].pfun && pc==&C)
+        S[k].pplain (A, size);
+    else if (!psink && S[k].pfun)
+        S[k].pcounting (pc, size);
+    else
+        psort (pc, size, lesser_than, read_thing, write_thing);
+
+    pc->psink = NULL;
+
+    // Checked without counting, so that the counters are those
+    // of the sort alone
+    for (u=0; u<size-1; u++)
+        if (A[u+1] < A[u])
+            break;
+
+    free_things (A, total_size(psort,size));
+    pc->pdata = NULL;
+
+    return u==size-1;
+}
+
+int generate_trace (function_sort * psort,
+                    function_prepare_data * pprepare,
+                    unsigned size,
+                    function_sink * psink, void * pctx,
+                    scontrol * pc)
+{
+    return generate (psort, pprepare, size, psink, NULL, pctx, pc);
+}
+
+int generate_trace_batch (function_sort * psort,
+                          function_prepare_data * pprepare,
+                          unsigned size,
+                          function_batch_sink * pbatch, void * pctx,
+                          scontrol * pc)
+{
+    return generate (psort, pprepare, size, NULL, pbatch, pctx, pc);
+}
+
+// Where the consumers of traces take them from
+
+// Maps a whole file to be read sequentially. NULL if it cannot
+// be mapped (e.g., it is a pipe).
+
+static void * map_file (int fd, size_t * psize)
+{
+    struct stat st;
+    void * p;
+
+    if (fstat(fd,&st)<0 || !S_ISREG(st.st_mode) || st.st_size==0)
+        return NULL;
+
+    p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (p==MAP_FAILED)
+        return NULL;
+
+    madvise (p, st.st_size, MADV_SEQUENTIAL);
+    *psize = st.st_size;
+
+    return p;
+}
+
+int source_is_file (const char * algorithm)
+{
+    return strchr(algorithm,'/') || strchr(algorithm,'.');
+}
+
+int source_open (ssource * pS, const char * algorithm,
+                 const char * initialstate, unsigned size)
+{
+    const char * dir;
+
+    pS->pf = NULL;
+    pS->psort = NULL;
+    pS->fd = -1;
+    pS->map = NULL;
+
+    if (!strcmp(algorithm,"-"))
+    {
+        pS->pf = stdin;
+        strcpy (pS->name, "standard input");
+        return trace_open (&pS->T, fileno(pS->pf), &pS->totalsz);
+    }
+
+    if (source_is_file(algorithm))
+    {
+        snprintf (pS->name, sizeof(pS->name), "file %s", algorithm);
+
+        if ((pS->fd=open(algorithm,O_RDONLY)) < 0)
+        {
+            perror ("ERROR opening the trace");
+            return 0;
+        }
+
+        // Decoded straight from the page cache, which is
+        // shared by every process that maps the same file
+        if ((pS->map=map_file(pS->fd,&pS->mapsz)))
+            return trace_open_memory (&pS->T, pS->map, pS->mapsz,
+                                      &pS->totalsz);
+
+        return trace_open (&pS->T, pS->fd, &pS->totalsz);
+    }
+
+    pS->psort = find_sort (algorithm);
+    pS->pprepare = find_prepare (initialstate);
+    pS->size = size;
+
+    snprintf (pS->name, sizeof(pS->name), "gen_trace %s %s %u",
+                        algorithm, initialstate, size);
+
+    pS->cache[0] = '\0';
+
+    if ((dir=getenv(TRACE_CACHE_ENV)) && *dir &&
+        strlen(algorithm)==3 && strlen(initialstate)==3)
+        snprintf (pS->cache, sizeof(pS->cache), "%s/%s-%s-%u.v%d.trb",
+                  dir, algorithm, initialstate, size, TRACEGEN_VERSION);
+
+    if (!pS->psort || !pS->pprepare || size<2)
+        return 0;
+
+    if (size > MAX_SIZE)
+    {
+        fprintf (stderr, "ERROR: too many elements (at most "
+                         "%u)\n", MAX_SIZE);
+        return 0;
+    }
+
+    pS->totalsz = total_size (pS->psort, size);
+
+    return 1;
+}
+
+// Sends every operation of a trace being read to psink, or
+// every batch to pbatch if there is no psink
+
+static int decode_trace (strace * pT, function_sink * psink,
+                         function_batch_sink * pbatch, void * pctx)
+{
+    unsigned refs[4096];     // One batch of operations
+    char end;
+    int n, u;
+
+    do
+    {
+        // Decode a batch of operations
+        if ((n=trace_next_batch(pT,refs,4096,&end)) < 0)
+            return 0;
+
+        if (!psink)
+        {
+            if (n)
+                pbatch (pctx, refs, n);
+        }
+        else
+            for (u=0; u<n; u++)
+                psink (pctx, TRACE_REF_OP(refs[u]),
+                             TRACE_REF_POS(refs[u]));
+    }
+    while (!end);
+
+    return end=='S';          // 'S'orted, or 'O'ut of order
+}
+
+// Functions of the cache of traces. replay_cached returns -1
+// if the trace is not in the cache.
+
+static int replay_cached (ssource * pS, function_sink * psink,
+                          function_batch_sink * pbatch, void * pctx)
+{
+    void * p;
+    size_t size;
+    unsigned totalsz;
+    int fd, ok;
+
+    if ((fd=open(pS->cache,O_RDONLY)) < 0)
+        return -1;
+
+    p = map_file (fd, &size);
+    close (fd);
+
+    if (!p)
+        return -1;
+
+    if (!trace_open_memory(&pS->T,p,size,&totalsz) ||
+        !pS->T.binary || totalsz!=pS->totalsz)
+    {
+        fprintf (stderr, "ERROR: wrong trace in the cache (%s)\n",
+                 pS->cache);
+        ok = 0;
+    }
+    else
+        ok = decode_trace (&pS->T, psink, pbatch, pctx);
+
+    munmap (p, size);
+
+    return ok;
+}
+
+// While a trace is generated, its operations are written to
+// the cache as well as sent to the sink
+
+typedef struct
+{
+    FILE * pf;
+    unsigned last;
+    function_sink * psink;     // (or NULL)
+    function_batch_sink * pbatch;
+    void * pctx;
+}
+scapture;
+
+static void capture_op (void * p, char op, unsigned pos)
+{
+    scapture * pK = (scapture*) p;
+
+    trace_put_op (pK->pf, &pK->last, op, pos);
+    pK->psink (pK->pctx, op, pos);
+}
+
+static void capture_batch (void * p, const unsigned * refs, unsigned n)
+{
+    scapture * pK = (scapture*) p;
+    unsigned u;
+
+    for (u=0; u<n; u++)
+        trace_put_op (pK->pf, &pK->last, TRACE_REF_OP(refs[u]),
+                      TRACE_REF_POS(refs[u]));
+
+    pK->pbatch (pK->pctx, refs, n);
+}
+
+// Generates the trace for psink, or else in batches for pbatch
+
+static int generate_source (ssource * pS, function_sink * psink,
+                            function_batch_sink * pbatch, void * pctx,
+                            scontrol * pc)
+{
+    if (psink)
+        return generate_trace (pS->psort, pS->pprepare, pS->size,
+                               psink, pctx, pc);
+
+    return generate_trace_batch (pS->psort, pS->pprepare, pS->size,
+                                 pbatch, pctx, pc);
+}
+
+static int generate_cached (ssource * pS, function_sink * psink,
+                            function_batch_sink * pbatch, void * pctx,
+                            scontrol * pc)
+{
+    char tmp[sizeof(pS->cache)+8];
+    scapture K;
+    int fd, n, ok;
+
+    // Written apart and renamed when complete, so that other
+    // processes never find half a trace
+    snprintf (tmp, sizeof(tmp), "%s.XXXXXX", pS->cache);
+
+    if ((fd=mkstemp(tmp)) < 0 || !(K.pf=fdopen(fd,"w")))
+    {
+        fprintf (stderr, "WARNING: cannot write to the trace "
+                         "cache (%s)\n", pS->cache);
+
+        if (fd>=0)
+        {
+            close (fd);
+            unlink (tmp);
+        }
+
+        return generate_source (pS, psink, pbatch, pctx, pc);
+    }
+
+    K.last = 0;
+    K.psink = psink;
+    K.pbatch = pbatch;
+    K.pctx = pctx;
+
+    trace_put_header (K.pf, pS->totalsz);
+
+    n = generate_source (pS, psink ? capture_op : NULL, capture_batch,
+                         &K, pc);
+
+    if (n>=0)
+        trace_put_end (K.pf, n);
+
+    ok = n>=0 && fchmod(fd,0644)==0;   // Not only for this user
+
+    if (fclose(K.pf)!=0 || !ok || rename(tmp,pS->cache)<0)
+        unlink (tmp);
+
+    return n;
+}
+
+static int run (ssource * pS, function_sink * psink,
+                function_batch_sink * pbatch, void * pctx)
+{
+    scontrol C;
+    int n;
+
+    if (pS->psort)
+    {
+        if (pS->cache[0] &&
+            (n=replay_cached(pS,psink,pbatch,pctx)) >= 0)
+            return n;
+
+        n = pS->cache[0] ?
+              generate_cached (pS, psink, pbatch, pctx, &C) :
+              generate_source (pS, psink, pbatch, pctx, &C);
+
+        if (n<0)
+            fprintf (stderr, "ERROR: not enough memory for "
+                             "the array to be sorted\n");
+
+        return n==1;
+    }
+
+    return decode_trace (&pS->T, psink, pbatch, pctx);
+}
+
+int source_run (ssource * pS, function_sink * psink, void * pctx)
+{
+    return run (pS, psink, NULL, pctx);
+}
+
+int source_run_batch (ssource * pS, function_batch_sink * pbatch,
+                      void * pctx)
+{
+    return run (pS, NULL, pbatch, pctx);
+}
+
+void source_close (ssource * pS)
+{
+    if (pS->map)
+        munmap (pS->map, pS->mapsz);
+
+    if (pS->fd >= 0)
+        close (pS->fd);
+
+    pS->pf = NULL;
+    pS->fd = -1;
+    pS->map = NULL;
+}
+
+// A trace kept in memory
+
+static void store_ref (sreferences * pR, unsigned ref)
+{
+    unsigned * refs;
+
+    if (!pR->refs)
+        return;
+
+    if (pR->numrefs==pR->capacity)
+    {
+        refs = (unsigned*) realloc (pR->refs,
+                                    2*pR->capacity*sizeof(unsigned));
+
+        if (!refs)
+        {
+            free (pR->refs);
+            pR->refs = NULL;  // Marks the error
+            return;
+        }
+
+        pR->refs = refs;
+        pR->capacity *= 2;
+    }
+
+    pR->refs[pR->numrefs++] = ref;
+}
+
+static void store_reference (void * p, char op, unsigned pos)
+{
+    if (op!='C')
+        store_ref ((sreferences*) p, TRACE_REF(op,pos));
+}
+
+static void store_batch (void * p, const unsigned * refs, unsigned n)
+{
+    unsigned u;
+
+    for (u=0; u<n; u++)
+        if ((refs[u]&3) != TRACE_OP_COMP)
+            store_ref ((sreferences*) p, refs[u]);
+}
+
+int load_references (sreferences * pR, ssource * pS)
+{
+    int ok;
+
+    pR->numrefs = 0;
+    pR->capacity = 1024;
+    pR->totalsz = pS->totalsz;
+    pR->refs = (unsigned*) malloc (pR->capacity*sizeof(unsigned));
+
+    if (!pR->refs)
+        return -1;
+
+    // Generated here (and not cached), the operations come in
+    // batches from the specialized version of the algorithm
+    if (pS->psort && !pS->cache[0])
+    {
+        ok = generate_trace_batch (pS->psort, pS->pprepare, pS->size,
+                                   store_batch, pR, NULL);
+
+        if (ok<0)
+            fprintf (stderr, "ERROR: not enough memory for "
+                             "the array to be sorted\n");
+
+        ok = ok==1;
+    }
+    else
+        ok = source_run (pS, store_reference, pR);
+
+    return pR->refs ? ok : -1;
+}
+
+void free_references (sreferences * pR)
+{
+    free (pR->refs);
+    pR->refs = NULL;
+}
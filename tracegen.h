@@ -0,0 +1,188 @@
+/*
+    tracegen.h
+*/
+
+#ifndef _TRACEGEN_H_
+#define _TRACEGEN_H_
+
+#include <stdio.h>
+
+#include "sort.h"
+#include "trace.h"
+
+// Library that runs the sorting algorithms of sort.c on an
+// instrumented array, so that every operation they perform
+// is delivered to a sink by direct function call. gen_trace
+// uses it to print the traces, and the simulators use it to
+// get the references without starting gen_trace.
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP/BMS/INT/RAD/IMS"
+#define VALID_INIT_ORD "ASC/DES/RAN/SHU"
+
+// Largest array that can be sorted: the positions of the
+// elements (up to twice the size for MER, BMS and RAD) must fit in
+// TRACE_REF (trace.h)
+
+#define MAX_SIZE (1U<<28)
+
+// Arrays of at least this many bytes are mapped from an
+// unlinked temporary file (in $TMPDIR, or /tmp) instead of
+// taken from malloc, so that their pages can go back to disk
+// instead of to the swap
+
+#define MMAP_THRESHOLD ((size_t)256<<20)
+
+// Type of the functions that receive the operations: 'R'ead
+// or 'W'rite of position pos, or 'C'omparison (pos is 0)
+
+typedef void function_sink (void * ctx, char op, unsigned pos);
+
+// Functions that prepare the data according to
+// different criteria: RAN shuffles with rand(), which keeps
+// its traces the same as always, and SHU takes each element
+// from a counter-based permutation, which is much faster for
+// big arrays (but gives other traces)
+
+typedef void function_prepare_data (thing A[], unsigned size);
+
+function_prepare_data ascending_order,
+                      descending_order,
+                      random_order,
+                      shuffled_order;
+
+// Functions that the sorting algorithms should use in order
+// to compare values of the array:
+
+function_lesser_than lesser_than,
+                     lesser_than_back_to_front;
+
+// The functions that access the array and compare its
+// values receive, as their first parameter, a pointer to a
+// structure of this type:
+
+typedef struct
+{
+    thing * pdata;            // Array with data to be sorted
+    unsigned long long nreads;        // Read operations counter
+    unsigned long long nwrites;       // Write operations counter
+    unsigned long long ncomparisons;  // Comparisons counter
+    function_sink * psink;    // Receives the operations (or NULL)
+    void * pctx;              // First parameter of psink
+}
+scontrol;
+
+// Functions that look for an algorithm or an initial state
+// by its name in the command line (NULL if it is unknown)
+
+function_sort * find_sort (const char * name);
+function_prepare_data * find_prepare (const char * name);
+
+// Total # of elements used by an algorithm (e.g., mergesort
+// and radix sort need twice the size of the array)
+
+unsigned total_size (function_sort * psort, unsigned size);
+
+// Function that prepares an array of the given size and sorts
+// it, sending every operation to psink (which can be NULL if
+// only the totals are needed). Leaves the counters of the sort
+// in *pc (which can be NULL too, if not even they are needed)
+// and returns 1 if the array ended up sorted, 0 if not, and -1
+// if there is not enough memory. size must be at most
+// MAX_SIZE.
+//
+// Without psink, the algorithms of find_sort run in versions
+// specialized at compile time (sort_impl.h), with the accesses
+// to the array inlined instead of called through pointers,
+// and so does generate_trace_batch, which sends the operations
+// (as in TRACE_REF, comparisons included) in batches to pbatch
+// instead of one by one. Both give exactly the same operations
+// and counters as generate_trace with a psink.
+
+typedef void function_batch_sink (void * ctx, const unsigned * refs,
+                                  unsigned n);
+
+int generate_trace (function_sort * psort,
+                    function_prepare_data * pprepare,
+                    unsigned size,
+                    function_sink * psink, void * pctx,
+                    scontrol * pc);
+int generate_trace_batch (function_sort * psort,
+                          function_prepare_data * pprepare,
+                          unsigned size,
+                          function_batch_sink * pbatch, void * pctx,
+                          scontrol * pc);
+
+// Where the consumers of traces (simulators etc.) take them
+// from: the generator above, or a trace in any of the formats
+// of trace.h read from the standard input ("-" instead of
+// the name of the algorithm) or from a file (its name instead
+// of the algorithm; see source_is_file). Regular files are
+// mapped with mmap and decoded from the mapping, without read
+// calls or copies.
+//
+// Generated traces depend only on the algorithm, the initial
+// state and the size, so if the environment variable
+// TRACE_CACHE_ENV names a directory, the first run stores
+// each trace there in binary format, in a file named after
+// them (and TRACEGEN_VERSION, to be increased whenever the
+// generated traces change), and the next runs map that file
+// and decode it instead of sorting again.
+
+#define TRACE_CACHE_ENV "SIM_TRACE_CACHE"
+#define TRACEGEN_VERSION 1
+
+typedef struct
+{
+    function_sort * psort;             // Generated in-process...
+    function_prepare_data * pprepare;
+    unsigned size;
+    FILE * pf;                         // ...or read from here
+    int fd;                            // ...or from a file
+    void * map;                        // (mapped if not NULL)
+    size_t mapsz;
+    strace T;
+    unsigned totalsz;                  // Total # of elements
+    char name[100];                    // For the reports
+    char cache[4096];                  // File in the cache, or ""
+}
+ssource;
+
+// Whether the name of the algorithm is the name of a trace
+// file instead (it has a '/' or a '.')
+
+int source_is_file (const char * algorithm);
+
+int source_open (ssource *, const char * algorithm,
+                 const char * initialstate, unsigned size);
+int source_run (ssource *, function_sink * psink, void * pctx);
+
+// Same as source_run, but the operations (as in TRACE_REF,
+// comparisons included) go to pbatch in batches (of up to 4096
+// of them), so that the consumer goes through an array at a
+// time instead of making one call per operation
+
+int source_run_batch (ssource *, function_batch_sink * pbatch,
+                      void * pctx);
+
+void source_close (ssource *);
+
+// A trace kept in memory, so that it can be simulated many
+// times (or by several threads at once) after generating it
+// only once. Comparisons are not kept.
+
+typedef struct
+{
+    unsigned * refs;          // See TRACE_REF (trace.h)
+    size_t numrefs;           // # of references
+    size_t capacity;          // Size of refs
+    unsigned totalsz;         // Total # of elements
+}
+sreferences;
+
+// Returns 1 if the whole trace was loaded (and sorted), 0 if
+// not, and -1 if there is not enough memory
+
+int load_references (sreferences *, ssource *);
+void free_references (sreferences *);
+
+#endif // _TRACEGEN_H_